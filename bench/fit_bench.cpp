@@ -0,0 +1,356 @@
+// fit_bench.cpp - Headless benchmark of the C++ and embedded Python fitters
+//
+// Sweeps synthetic traces over sizes, noise levels and outlier rates and
+// reports per-phase medians, throughput and how time scales with size.
+// Nothing is drawn or logged while timing, so the numbers are free of GUI cost.
+//
+//   fit_bench [--sizes 1e2:1e6] [--steps 1] [--noise 0.3,1.0] [--outliers 0,0.05]
+//             [--python script.py] [--daemon] [--warmup 2] [--reps 10] [--budget 10]
+//             [--seed 42] [--csv results.csv]
+#include "../classes/BenchmarkHarness.h"
+#include "../classes/CppSineFitter.h"
+#include "../classes/EngineSink.h"
+#include "../classes/PythonEngine.h"
+#include "../classes/SineDataGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+struct Config {
+    double minSize = 1e2;
+    double maxSize = 1e6;
+    int stepsPerDecade = 1;
+    std::vector<double> noise{0.3};
+    std::vector<double> outliers{0.05};
+    std::string pythonScript;  // path; empty runs C++ only
+    bool daemon = false;       // also run the script on the shared worker daemon
+    size_t warmup = 2;
+    size_t repetitions = 10;
+    double budgetSeconds = 10.0;  // per sweep point; large sizes get fewer runs
+    unsigned seed = 42;
+    std::string csvPath;
+};
+
+// One timed phase of one case at one sweep point
+struct Row {
+    size_t size;
+    double noise;
+    double outliers;
+    std::string name;
+    std::string phase;
+    BenchmarkHarness::Stats stats;
+};
+
+void printUsage() {
+    std::cout <<
+        "Usage: fit_bench [options]\n"
+        "  --sizes MIN:MAX     trace sizes, log-spaced (default 1e2:1e6, up to 1e8)\n"
+        "  --steps N           sizes per decade (default 1)\n"
+        "  --noise LIST        comma-separated noise scales (default 0.3)\n"
+        "  --outliers LIST     comma-separated spike rates (default 0.05)\n"
+        "  --python FILE       also time this analysis script in the embedded engine\n"
+        "  --daemon            also time the script on the shared warm worker daemon\n"
+        "  --warmup N          untimed runs per sweep point (default 2)\n"
+        "  --reps N            timed runs per sweep point (default 10)\n"
+        "  --budget SECONDS    cap per sweep point; fewer runs for large sizes (default 10)\n"
+        "  --seed N            data generator seed (default 42)\n"
+        "  --csv FILE          write every phase of every sweep point as CSV\n";
+}
+
+std::vector<double> parseList(const std::string& text) {
+    std::vector<double> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(std::stod(item));
+    }
+    if (values.empty()) {
+        throw std::invalid_argument("empty list: " + text);
+    }
+    return values;
+}
+
+Config parseArguments(int argc, char* argv[]) {
+    Config config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            std::exit(0);
+        }
+        if (arg == "--daemon") {
+            config.daemon = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("missing value for " + arg);
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--sizes") {
+            auto colon = value.find(':');
+            config.minSize = std::stod(value.substr(0, colon));
+            config.maxSize = colon == std::string::npos ? config.minSize : std::stod(value.substr(colon + 1));
+        } else if (arg == "--steps") {
+            config.stepsPerDecade = std::max(1, std::stoi(value));
+        } else if (arg == "--noise") {
+            config.noise = parseList(value);
+        } else if (arg == "--outliers") {
+            config.outliers = parseList(value);
+        } else if (arg == "--python") {
+            config.pythonScript = value;
+        } else if (arg == "--warmup") {
+            config.warmup = std::stoul(value);
+        } else if (arg == "--reps") {
+            config.repetitions = std::max<size_t>(1, std::stoul(value));
+        } else if (arg == "--budget") {
+            config.budgetSeconds = std::stod(value);
+        } else if (arg == "--seed") {
+            config.seed = static_cast<unsigned>(std::stoul(value));
+        } else if (arg == "--csv") {
+            config.csvPath = value;
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    if (config.minSize < 2 || config.maxSize < config.minSize) {
+        throw std::invalid_argument("--sizes needs 2 <= MIN <= MAX");
+    }
+    if (config.daemon && config.pythonScript.empty()) {
+        throw std::invalid_argument("--daemon needs --python");
+    }
+    return config;
+}
+
+std::vector<size_t> sweepSizes(const Config& config) {
+    std::vector<size_t> sizes;
+    double decades = std::log10(config.maxSize / config.minSize);
+    int steps = static_cast<int>(std::floor(decades * config.stepsPerDecade + 1e-9));
+    for (int k = 0; k <= steps; ++k) {
+        auto size = static_cast<size_t>(std::llround(config.minSize * std::pow(10.0, double(k) / config.stepsPerDecade)));
+        if (sizes.empty() || size != sizes.back()) sizes.push_back(size);
+    }
+    return sizes;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+std::string formatDuration(double us) {
+    std::ostringstream out;
+    out << std::fixed;
+    if (us >= 1e6) {
+        out << std::setprecision(2) << us / 1e6 << " s";
+    } else if (us >= 1e3) {
+        out << std::setprecision(2) << us / 1e3 << " ms";
+    } else {
+        out << std::setprecision(1) << us << " us";
+    }
+    return out.str();
+}
+
+// Points per second through a phase, from its median
+double throughput(size_t size, const BenchmarkHarness::Stats& stats) {
+    return stats.median > 0 ? static_cast<double>(size) / (stats.median * 1e-6) : 0.0;
+}
+
+// Exponent b of time ~ size^b between two sweep points; 1 is linear
+double scalingExponent(size_t sizeA, double timeA, size_t sizeB, double timeB) {
+    if (timeA <= 0 || timeB <= 0 || sizeA == sizeB) return 0.0;
+    return std::log(timeB / timeA) / std::log(static_cast<double>(sizeB) / static_cast<double>(sizeA));
+}
+
+void writeCsv(const std::string& path, const std::vector<Row>& rows, const std::map<std::string, std::string>& metadata) {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path + " for writing");
+    }
+    for (const auto& [key, value] : metadata) {
+        file << "# " << key << ": " << value << '\n';
+    }
+    file << "size,noise,outliers,case,phase,samples,median_us,ci_low_us,ci_high_us,p10_us,p90_us,stddev_us,points_per_s\n";
+    file << std::setprecision(9);
+    for (const auto& row : rows) {
+        const auto& st = row.stats;
+        file << row.size << ',' << row.noise << ',' << row.outliers << ',' << row.name << ',' << row.phase << ','
+             << st.samples << ',' << st.median << ',' << st.ci_low << ',' << st.ci_high << ','
+             << st.p10 << ',' << st.p90 << ',' << st.stddev << ',' << throughput(row.size, st) << '\n';
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        Config config = parseArguments(argc, argv);
+        auto sizes = sweepSizes(config);
+
+        std::string script;
+        std::unique_ptr<PythonEngine> engine;
+        if (!config.pythonScript.empty()) {
+            script = readFile(config.pythonScript);
+            engine = std::make_unique<PythonEngine>();
+            engine->setSink(std::make_shared<StreamSink>(std::cerr, std::cerr));
+            engine->initialize();
+            // Print calls cost nothing while muted, as in the GUI benchmark;
+            // failures still surface as exceptions
+            engine->setOutputMuted(true);
+            if (config.daemon) {
+                engine->setWorkerDaemon(PythonWorkerPool::defaultDaemonSocket());
+            }
+        }
+
+        std::map<std::string, std::string> metadata;
+        metadata["seed"] = std::to_string(config.seed);
+#ifdef NDEBUG
+        metadata["build_type"] = "release";
+#else
+        metadata["build_type"] = "debug";
+#endif
+#ifdef __VERSION__
+        metadata["compiler"] = __VERSION__;
+#endif
+        if (engine) metadata["python_script"] = config.pythonScript;
+
+        std::vector<Row> rows;
+        std::cout << std::left << std::setw(11) << "size" << std::setw(7) << "noise" << std::setw(9) << "outliers"
+                  << std::setw(8) << "case" << std::setw(11) << "phase" << std::right << std::setw(12) << "median"
+                  << std::setw(26) << "95% CI" << std::setw(6) << "runs" << std::setw(14) << "Mpts/s" << '\n';
+
+        for (double noise : config.noise) {
+            for (double outliers : config.outliers) {
+                for (size_t size : sizes) {
+                    // Same seed per point, so noise and outlier rate are the only differences
+                    std::mt19937 rng(config.seed);
+                    SineDataGenerator::Options options;
+                    options.points = size;
+                    options.noise = noise;
+                    options.outlierRate = outliers;
+                    auto trace = SineDataGenerator::generate(rng, options);
+
+                    BenchmarkHarness harness;
+                    harness.addCase("C++", [&](BenchmarkHarness::Sample& sample) {
+                        auto fitter = sample.time("marshal", [&]() { return CppSineFitter(trace.x, trace.y); });
+                        sample.time("compute", [&]() { return fitter.fit(300); });
+                    });
+                    if (engine) {
+                        harness.addCase("Python", [&](BenchmarkHarness::Sample& sample) {
+                            engine->setData(trace.x, trace.y);
+                            engine->executeScript(script);
+                            engine->getFitResult();
+                            const auto& phases = engine->lastProfile();
+                            sample.record("marshal", phases.marshalIn);
+                            sample.record("compile", phases.compile);
+                            sample.record("compute", phases.execute);
+                            sample.record("unmarshal", phases.marshalOut);
+                        });
+                    }
+                    if (engine && config.daemon) {
+                        // The first probe run pays for starting the daemon
+                        harness.addCase("Daemon", [&](BenchmarkHarness::Sample& sample) {
+                            auto results = engine->map(script, {{trace.x, trace.y}});
+                            if (!results.front().ok) {
+                                throw std::runtime_error("Daemon run failed: " + results.front().error);
+                            }
+                            sample.record("compute", results.front().fit.fit_time);
+                        });
+                    }
+
+                    // One probe run sizes the repetitions to the budget and
+                    // doubles as the first warm-up
+                    BenchmarkHarness::Options probeOptions;
+                    probeOptions.warmup = 0;
+                    probeOptions.repetitions = 1;
+                    auto probe = harness.run(probeOptions);
+                    double probeSeconds = 0.0;
+                    for (const auto& result : probe.cases) {
+                        probeSeconds += result.series.front().stats.median * 1e-6;
+                    }
+
+                    BenchmarkHarness::Options runOptions;
+                    runOptions.warmup = config.warmup > 0 ? config.warmup - 1 : 0;
+                    runOptions.repetitions = config.repetitions;
+                    if (probeSeconds > 0) {
+                        double affordable = config.budgetSeconds / probeSeconds;
+                        if (affordable < double(runOptions.warmup + runOptions.repetitions)) {
+                            runOptions.warmup = 0;
+                            runOptions.repetitions = std::clamp<size_t>(static_cast<size_t>(affordable), 1, config.repetitions);
+                        }
+                    }
+                    auto report = harness.run(runOptions);
+
+                    for (const auto& result : report.cases) {
+                        for (const auto& series : result.series) {
+                            const auto& st = series.stats;
+                            rows.push_back({size, noise, outliers, result.name, series.phase, st});
+                            std::cout << std::left << std::setw(11) << size << std::setw(7) << noise
+                                      << std::setw(9) << outliers << std::setw(8) << result.name
+                                      << std::setw(11) << series.phase << std::right
+                                      << std::setw(12) << formatDuration(st.median)
+                                      << std::setw(26) << ("[" + formatDuration(st.ci_low) + ", " + formatDuration(st.ci_high) + "]")
+                                      << std::setw(6) << st.samples
+                                      << std::setw(14) << std::fixed << std::setprecision(3)
+                                      << throughput(size, st) / 1e6 << std::defaultfloat << '\n';
+                        }
+                    }
+                    std::cout.flush();
+                }
+            }
+        }
+
+        // Scaling: exponent of time ~ size^b between neighbouring sizes, per
+        // case and phase. Values well above 1 mark a scaling limit.
+        if (sizes.size() > 1) {
+            std::cout << "\nScaling exponents (1.0 = linear) between neighbouring sizes:\n";
+            std::map<std::tuple<double, double, std::string, std::string>, std::vector<const Row*>> curves;
+            for (const auto& row : rows) {
+                curves[{row.noise, row.outliers, row.name, row.phase}].push_back(&row);
+            }
+            for (const auto& [key, points] : curves) {
+                const auto& [noise, outliers, name, phase] = key;
+                std::cout << "  noise " << noise << ", outliers " << outliers << ", " << name << " " << phase << ":";
+                double worst = 0.0;
+                for (size_t i = 1; i < points.size(); ++i) {
+                    double b = scalingExponent(points[i - 1]->size, points[i - 1]->stats.median,
+                                               points[i]->size, points[i]->stats.median);
+                    worst = std::max(worst, b);
+                    std::cout << ' ' << std::fixed << std::setprecision(2) << b << std::defaultfloat;
+                }
+                // Small sizes are dominated by fixed overhead, so only flag clear superlinearity
+                if (worst > 1.2) std::cout << "  <- superlinear";
+                std::cout << '\n';
+            }
+        }
+
+        if (!config.csvPath.empty()) {
+            writeCsv(config.csvPath, rows, metadata);
+            std::cout << "\nWrote " << rows.size() << " rows to " << config.csvPath << '\n';
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "fit_bench: " << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,120 @@
+#include "AsyncTraceRenderer.h"
+#include <cmath>
+
+namespace {
+
+// How many samples are drawn between checks for newer requests
+constexpr size_t kSupersededCheckInterval = 4096;
+
+}
+
+AsyncTraceRenderer::AsyncTraceRenderer(QObject* context, Callback onFrame)
+    : context(context)
+    , onFrame(std::move(onFrame)) {
+    thread = std::thread([this]() { run(); });
+}
+
+AsyncTraceRenderer::~AsyncTraceRenderer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+uint64_t AsyncTraceRenderer::request(Request request) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending) ++counters.coalesced;
+        ++counters.requested;
+        id = latestId.fetch_add(1) + 1;
+        pending = std::move(request);
+        pendingId = id;
+    }
+    wake.notify_one();
+    return id;
+}
+
+AsyncTraceRenderer::Stats AsyncTraceRenderer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void AsyncTraceRenderer::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this]() { return !running || pending; });
+        if (!running) return;
+
+        Request request = std::move(*pending);
+        pending.reset();
+        uint64_t id = pendingId;
+
+        lock.unlock();
+        auto frame = render(request, id);
+        lock.lock();
+
+        if (!frame) {
+            ++counters.abandoned;
+            continue;
+        }
+        ++counters.rendered;
+        QMetaObject::invokeMethod(context, [callback = onFrame, frame = std::move(*frame)]() mutable {
+            callback(std::move(frame));
+        }, Qt::QueuedConnection);
+    }
+}
+
+std::optional<AsyncTraceRenderer::Frame> AsyncTraceRenderer::render(const Request& request, uint64_t id) const {
+    Frame frame;
+    frame.id = id;
+    if (request.size.isEmpty() || request.xRange.size() <= 0 || request.yRange.size() <= 0) return frame;
+
+    // Every marker is the same, so draw it once and stamp it
+    qreal dpr = request.devicePixelRatio;
+    QPen markerPen = request.scatter.isPenDefined() ? request.scatter.pen() : request.pen;
+    int side = static_cast<int>(std::ceil(request.scatter.size() + markerPen.widthF())) + 2;
+    QImage sprite(QSize(side, side) * dpr, QImage::Format_ARGB32_Premultiplied);
+    sprite.setDevicePixelRatio(dpr);
+    sprite.fill(Qt::transparent);
+    {
+        QCPPainter painter(&sprite);
+        painter.setRenderHint(QPainter::Antialiasing, request.antialiased);
+        request.scatter.applyTo(&painter, request.pen);
+        request.scatter.drawShape(&painter, side / 2.0, side / 2.0);
+    }
+
+    int margin = side / 2 + 1;
+    double width = request.size.width();
+    double height = request.size.height();
+    double keysPerPixel = request.xRange.size() / width;
+    double valuesPerPixel = request.yRange.size() / height;
+    frame.margin = margin;
+    frame.xRange = QCPRange(request.xRange.lower - margin * keysPerPixel, request.xRange.upper + margin * keysPerPixel);
+    frame.yRange = QCPRange(request.yRange.lower - margin * valuesPerPixel, request.yRange.upper + margin * valuesPerPixel);
+
+    frame.image = QImage((request.size + QSize(2 * margin, 2 * margin)) * dpr, QImage::Format_ARGB32_Premultiplied);
+    frame.image.setDevicePixelRatio(dpr);
+    frame.image.fill(Qt::transparent);
+
+    auto x = request.data.x();
+    auto y = request.data.y();
+    size_t count = request.indices.empty() ? x.size() : request.indices.size();
+    double right = width + 2 * margin;
+    double bottom = height + 2 * margin;
+
+    QPainter painter(&frame.image);
+    for (size_t i = 0; i < count; ++i) {
+        if (i % kSupersededCheckInterval == 0 && latestId.load(std::memory_order_relaxed) > id + 1) {
+            return std::nullopt;
+        }
+        size_t index = request.indices.empty() ? i : request.indices[i];
+        double px = (x[index] - frame.xRange.lower) / keysPerPixel;
+        double py = (frame.yRange.upper - y[index]) / valuesPerPixel;
+        if (!(px >= 0 && py >= 0 && px <= right && py <= bottom)) continue;  // also skips NaN
+        painter.drawImage(QPointF(px - side / 2.0, py - side / 2.0), sprite);
+    }
+    return frame;
+}
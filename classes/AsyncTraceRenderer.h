@@ -0,0 +1,82 @@
+// AsyncTraceRenderer.h - Rasterizes the data trace on a worker thread
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "DataSet.h"
+#include "qcustomplot_wrapper.h"
+
+// Draws the scatter points of a trace snapshot into a transparent QImage off
+// the GUI thread. A request that arrives before the worker picks up the
+// previous one replaces it. A finished frame is delivered even if a newer
+// request is waiting, so a steady pan or zoom still shows frames; only one
+// that falls two requests behind while rendering is abandoned. Finished
+// frames are queued to `context`'s thread and handed to the callback there.
+//
+// The snapshot maps keys and values linearly onto the image (linear,
+// non-reversed axes), which is what the plot uses.
+class AsyncTraceRenderer {
+public:
+    struct Request {
+        DataSet data;
+        std::vector<size_t> indices;  // level-of-detail view; empty draws every sample
+        QCPRange xRange;
+        QCPRange yRange;
+        QSize size;                   // axis rect, device-independent pixels
+        qreal devicePixelRatio = 1;
+        QCPScatterStyle scatter;      // not ssPixmap: QPixmap is GUI-thread only
+        QPen pen;                     // used when the scatter style has none
+        bool antialiased = true;
+    };
+
+    // The image covers xRange/yRange, which extend the requested ranges by
+    // `margin` pixels on each side so markers at the edges are not cut off
+    struct Frame {
+        uint64_t id = 0;
+        QImage image;
+        QCPRange xRange;
+        QCPRange yRange;
+        int margin = 0;
+    };
+
+    struct Stats {
+        uint64_t requested = 0;
+        uint64_t rendered = 0;
+        uint64_t coalesced = 0;  // replaced before the worker started them
+        uint64_t abandoned = 0;  // two requests behind while rendering
+    };
+
+    using Callback = std::function<void(Frame frame)>;
+
+    AsyncTraceRenderer(QObject* context, Callback onFrame);
+    ~AsyncTraceRenderer();
+
+    AsyncTraceRenderer(const AsyncTraceRenderer&) = delete;
+    AsyncTraceRenderer& operator=(const AsyncTraceRenderer&) = delete;
+
+    // Returns the id the frame will carry; never blocks on rendering
+    uint64_t request(Request request);
+    Stats stats() const;
+
+private:
+    void run();
+    // Empty when it fell two requests behind mid-render
+    std::optional<Frame> render(const Request& request, uint64_t id) const;
+
+    QObject* context;
+    Callback onFrame;
+
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::optional<Request> pending;
+    uint64_t pendingId = 0;
+    std::atomic<uint64_t> latestId{0};
+    Stats counters;
+    bool running = true;
+};
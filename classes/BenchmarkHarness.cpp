@@ -0,0 +1,226 @@
+#include "BenchmarkHarness.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+double toMicroseconds(BenchmarkHarness::Duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+// Linear interpolation between closest ranks
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    double rank = p * static_cast<double>(sorted.size() - 1);
+    size_t lower = static_cast<size_t>(std::floor(rank));
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (rank - static_cast<double>(lower)) * (sorted[upper] - sorted[lower]);
+}
+
+std::string jsonString(const std::string& text) {
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"':  out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (c < 0x20) {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+            } else {
+                out << c;
+            }
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+std::string csvField(const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) return text;
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + '"';
+}
+
+}
+
+void BenchmarkHarness::Sample::record(const std::string& phase, Duration duration) {
+    phases.emplace_back(phase, duration);
+}
+
+const BenchmarkHarness::Series* BenchmarkHarness::CaseResult::find(const std::string& phase) const {
+    for (const auto& s : series) {
+        if (s.phase == phase) return &s;
+    }
+    return nullptr;
+}
+
+const BenchmarkHarness::CaseResult* BenchmarkHarness::Report::find(const std::string& name) const {
+    for (const auto& c : cases) {
+        if (c.name == name) return &c;
+    }
+    return nullptr;
+}
+
+void BenchmarkHarness::addCase(const std::string& name, std::function<void(Sample&)> body) {
+    cases.emplace_back(name, std::move(body));
+}
+
+BenchmarkHarness::Report BenchmarkHarness::run(const Options& options) const {
+    Report report;
+    report.options = options;
+    for (const auto& [name, body] : cases) {
+        report.cases.push_back({name, {{"total", {}, {}}}});
+    }
+
+    for (size_t rep = 0; rep < options.warmup + options.repetitions; ++rep) {
+        bool timed = rep >= options.warmup;
+        for (size_t i = 0; i < cases.size(); ++i) {
+            Sample sample;
+            auto start = Clock::now();
+            cases[i].second(sample);
+            auto total = Clock::now() - start;
+            if (!timed) continue;
+
+            auto& result = report.cases[i];
+            result.series.front().samples.push_back(toMicroseconds(total));
+            for (const auto& [phase, duration] : sample.phases) {
+                auto it = std::find_if(result.series.begin(), result.series.end(),
+                                       [&phase](const Series& s) { return s.phase == phase; });
+                if (it == result.series.end()) {
+                    result.series.push_back({phase, {}, {}});
+                    it = result.series.end() - 1;
+                }
+                it->samples.push_back(toMicroseconds(duration));
+            }
+        }
+    }
+
+    for (auto& result : report.cases) {
+        for (auto& s : result.series) {
+            s.stats = summarize(s.samples);
+        }
+    }
+    return report;
+}
+
+BenchmarkHarness::Stats BenchmarkHarness::summarize(std::vector<double> samples) {
+    Stats stats;
+    stats.samples = samples.size();
+    if (samples.empty()) return stats;
+
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    stats.min = samples.front();
+    stats.max = samples.back();
+
+    double sum = 0.0;
+    for (double value : samples) sum += value;
+    stats.mean = sum / static_cast<double>(n);
+    double squares = 0.0;
+    for (double value : samples) squares += (value - stats.mean) * (value - stats.mean);
+    stats.stddev = n > 1 ? std::sqrt(squares / static_cast<double>(n - 1)) : 0.0;
+
+    stats.median = percentile(samples, 0.5);
+    stats.p10 = percentile(samples, 0.10);
+    stats.p90 = percentile(samples, 0.90);
+    stats.p95 = percentile(samples, 0.95);
+
+    // Order-statistic CI for the median (normal approximation to the
+    // binomial); needs no assumption about the timing distribution
+    double half = 1.96 * std::sqrt(static_cast<double>(n)) / 2.0;
+    double centre = static_cast<double>(n) / 2.0;
+    long low = static_cast<long>(std::floor(centre - half));
+    long high = static_cast<long>(std::ceil(centre + half));
+    stats.ci_low = samples[static_cast<size_t>(std::clamp(low, 0L, static_cast<long>(n - 1)))];
+    stats.ci_high = samples[static_cast<size_t>(std::clamp(high - 1, 0L, static_cast<long>(n - 1)))];
+    return stats;
+}
+
+BenchmarkHarness::Ratio BenchmarkHarness::ratio(const Stats& a, const Stats& b) {
+    Ratio r;
+    if (b.median > 0) r.value = a.median / b.median;
+    if (b.ci_high > 0) r.low = a.ci_low / b.ci_high;
+    if (b.ci_low > 0) r.high = a.ci_high / b.ci_low;
+    return r;
+}
+
+std::string BenchmarkHarness::toCsv(const Report& report) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    for (const auto& [key, value] : report.metadata) {
+        out << "# " << key << ": " << value << '\n';
+    }
+    out << "# warmup: " << report.options.warmup << '\n';
+    out << "# repetitions: " << report.options.repetitions << '\n';
+    out << "case,phase,samples,min_us,median_us,mean_us,stddev_us,p10_us,p90_us,p95_us,ci_low_us,ci_high_us\n";
+    for (const auto& result : report.cases) {
+        for (const auto& s : result.series) {
+            const Stats& st = s.stats;
+            out << csvField(result.name) << ',' << csvField(s.phase) << ',' << st.samples << ','
+                << st.min << ',' << st.median << ',' << st.mean << ',' << st.stddev << ','
+                << st.p10 << ',' << st.p90 << ',' << st.p95 << ',' << st.ci_low << ',' << st.ci_high << '\n';
+        }
+    }
+    return out.str();
+}
+
+std::string BenchmarkHarness::toJson(const Report& report) {
+    std::ostringstream out;
+    out << std::setprecision(9);
+    out << "{\n  \"metadata\": {";
+    bool first = true;
+    for (const auto& [key, value] : report.metadata) {
+        out << (first ? "\n" : ",\n") << "    " << jsonString(key) << ": " << jsonString(value);
+        first = false;
+    }
+    out << (first ? "" : "\n  ") << "},\n";
+    out << "  \"warmup\": " << report.options.warmup << ",\n";
+    out << "  \"repetitions\": " << report.options.repetitions << ",\n";
+    out << "  \"cases\": [";
+    for (size_t c = 0; c < report.cases.size(); ++c) {
+        const auto& result = report.cases[c];
+        out << (c ? ",\n" : "\n") << "    {\n      \"name\": " << jsonString(result.name) << ",\n      \"phases\": {";
+        for (size_t p = 0; p < result.series.size(); ++p) {
+            const auto& s = result.series[p];
+            const Stats& st = s.stats;
+            out << (p ? ",\n" : "\n") << "        " << jsonString(s.phase) << ": {"
+                << "\"samples\": " << st.samples << ", \"min_us\": " << st.min
+                << ", \"median_us\": " << st.median << ", \"mean_us\": " << st.mean
+                << ", \"stddev_us\": " << st.stddev << ", \"p10_us\": " << st.p10
+                << ", \"p90_us\": " << st.p90 << ", \"p95_us\": " << st.p95
+                << ", \"ci_low_us\": " << st.ci_low << ", \"ci_high_us\": " << st.ci_high
+                << ", \"samples_us\": [";
+            for (size_t i = 0; i < s.samples.size(); ++i) {
+                out << (i ? ", " : "") << s.samples[i];
+            }
+            out << "]}";
+        }
+        out << "\n      }\n    }";
+    }
+    out << (report.cases.empty() ? "" : "\n  ") << "]\n}\n";
+    return out.str();
+}
+
+void BenchmarkHarness::save(const Report& report, const std::string& path) {
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path + " for writing");
+    }
+    file << (json ? toJson(report) : toCsv(report));
+    if (!file) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
@@ -0,0 +1,106 @@
+// BenchmarkHarness.h - Repeated, phase-separated timing with robust statistics
+#pragma once
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Runs named cases for a number of warm-up and timed repetitions. The cases
+// are interleaved within each repetition so slow drift (thermal throttling,
+// background load) affects all of them alike. Each case times its own phases;
+// the harness times the whole call. Results are reported as medians and
+// percentiles with a distribution-free confidence interval for the median.
+class BenchmarkHarness {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Duration = std::chrono::nanoseconds;
+
+    struct Options {
+        size_t warmup = 3;
+        size_t repetitions = 20;
+    };
+
+    // Handed to a case on every run to collect its phase timings
+    class Sample {
+    public:
+        template <typename F>
+        auto time(const std::string& phase, F&& body) {
+            auto start = Clock::now();
+            if constexpr (std::is_void_v<std::invoke_result_t<F>>) {
+                body();
+                record(phase, Clock::now() - start);
+            } else {
+                auto result = body();
+                record(phase, Clock::now() - start);
+                return result;
+            }
+        }
+
+        // For phases measured elsewhere, e.g. inside the Python engine
+        void record(const std::string& phase, Duration duration);
+
+    private:
+        friend class BenchmarkHarness;
+        std::vector<std::pair<std::string, Duration>> phases;
+    };
+
+    // All values in microseconds
+    struct Stats {
+        size_t samples = 0;
+        double min = 0.0;
+        double max = 0.0;
+        double mean = 0.0;
+        double stddev = 0.0;
+        double median = 0.0;
+        double p10 = 0.0;
+        double p90 = 0.0;
+        double p95 = 0.0;
+        double ci_low = 0.0;   // 95% confidence interval of the median
+        double ci_high = 0.0;
+    };
+
+    struct Series {
+        std::string phase;             // "total" for the whole case
+        std::vector<double> samples;   // microseconds, in run order
+        Stats stats;
+    };
+
+    struct CaseResult {
+        std::string name;
+        std::vector<Series> series;    // total first, then phases in first-seen order
+
+        const Series* find(const std::string& phase) const;
+    };
+
+    struct Report {
+        Options options;
+        std::map<std::string, std::string> metadata;
+        std::vector<CaseResult> cases;
+
+        const CaseResult* find(const std::string& name) const;
+    };
+
+    void addCase(const std::string& name, std::function<void(Sample&)> body);
+    Report run(const Options& options) const;
+
+    static Stats summarize(std::vector<double> samples);
+
+    // Ratio of medians of a/b with a conservative range from the two CIs
+    struct Ratio {
+        double value = 0.0;
+        double low = 0.0;
+        double high = 0.0;
+    };
+    static Ratio ratio(const Stats& a, const Stats& b);
+
+    static std::string toCsv(const Report& report);
+    static std::string toJson(const Report& report);
+    // Format chosen by extension (.json, anything else is CSV); throws on I/O errors
+    static void save(const Report& report, const std::string& path);
+
+private:
+    std::vector<std::pair<std::string, std::function<void(Sample&)>>> cases;
+};
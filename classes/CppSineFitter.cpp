@@ -1,8 +1,16 @@
 #include "CppSineFitter.h"
 #include <stdexcept>
 #include <complex>
+#include <atomic>
+#include <exception>
+#include <thread>
 
 CppSineFitter::CppSineFitter(const std::vector<double>& x_data, const std::vector<double>& y_data)
+    : x_storage(x_data), y_storage(y_data), x_data(x_storage), y_data(y_storage) {
+    validateData();
+}
+
+CppSineFitter::CppSineFitter(std::span<const double> x_data, std::span<const double> y_data)
     : x_data(x_data), y_data(y_data) {
     validateData();
 }
@@ -128,6 +136,7 @@ std::array<double, 4> CppSineFitter::levenbergMarquardt(const std::array<double,
                                                          int max_iter, double lambda_init) const {
     std::array<double, 4> params = initial_params;
     double lambda_lm = lambda_init;
+    std::vector<double> J(x_data.size() * 4);
     
     for (int iteration = 0; iteration < max_iter; ++iteration) {
         // Compute residuals
@@ -139,20 +148,19 @@ std::array<double, 4> CppSineFitter::levenbergMarquardt(const std::array<double,
         }
         
         // Compute Jacobian
-        auto jacobian = computeJacobian(params);
+        jacobian(params, J);
         
         // Compute JtJ and Jtr
         std::array<std::array<double, 4>, 4> JtJ = {};
         std::array<double, 4> Jtr = {};
         
-        for (int i = 0; i < 4; ++i) {
-            for (int j = 0; j < 4; ++j) {
-                for (size_t k = 0; k < x_data.size(); ++k) {
-                    JtJ[i][j] += jacobian[k][i] * jacobian[k][j];
+        for (size_t k = 0; k < x_data.size(); ++k) {
+            const double* row = &J[k * 4];
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) {
+                    JtJ[i][j] += row[i] * row[j];
                 }
-            }
-            for (size_t k = 0; k < x_data.size(); ++k) {
-                Jtr[i] += jacobian[k][i] * residuals[k];
+                Jtr[i] += row[i] * residuals[k];
             }
         }
         
@@ -261,21 +269,41 @@ std::array<double, 4> CppSineFitter::differentialEvolution(const std::vector<std
     return population[best_idx];
 }
 
-std::vector<std::vector<double>> CppSineFitter::computeJacobian(const std::array<double, 4>& params) const {
-    std::vector<std::vector<double>> jacobian(x_data.size(), std::vector<double>(4));
+void CppSineFitter::jacobian(const std::array<double, 4>& params, std::span<double> out) const {
+    if (out.size() != x_data.size() * 4) {
+        throw std::invalid_argument("Jacobian output must hold 4 values per data point");
+    }
+    double amplitude = params[0], frequency = params[1], phase = params[2];
     
     for (size_t i = 0; i < x_data.size(); ++i) {
         double x = x_data[i];
-        double amplitude = params[0], frequency = params[1], phase = params[2];
+        double s = std::sin(frequency * x + phase);
+        double c = std::cos(frequency * x + phase);
         
         // Partial derivatives
-        jacobian[i][0] = std::sin(frequency * x + phase);                    // dA
-        jacobian[i][1] = amplitude * x * std::cos(frequency * x + phase);    // df
-        jacobian[i][2] = amplitude * std::cos(frequency * x + phase);        // dphi
-        jacobian[i][3] = 1.0;                                                // dc
+        out[i * 4 + 0] = s;                  // dA
+        out[i * 4 + 1] = amplitude * x * c;  // df
+        out[i * 4 + 2] = amplitude * c;      // dphi
+        out[i * 4 + 3] = 1.0;                // dc
+    }
+}
+
+void CppSineFitter::residuals(const std::array<double, 4>& params, std::span<double> out) const {
+    if (out.size() != x_data.size()) {
+        throw std::invalid_argument("Residual output must hold one value per data point");
+    }
+    for (size_t i = 0; i < x_data.size(); ++i) {
+        out[i] = y_data[i] - sineModel(x_data[i], params[0], params[1], params[2], params[3]);
+    }
+}
+
+void CppSineFitter::objectiveBatch(std::span<const double> params, std::span<double> out) const {
+    if (params.size() != out.size() * 4) {
+        throw std::invalid_argument("Parameter batch must hold 4 values per output");
+    }
+    for (size_t k = 0; k < out.size(); ++k) {
+        out[k] = objective({params[k * 4], params[k * 4 + 1], params[k * 4 + 2], params[k * 4 + 3]});
     }
-    
-    return jacobian;
 }
 
 double CppSineFitter::objective(const std::array<double, 4>& params) const {
@@ -321,12 +349,13 @@ CppSineFitter::Metrics CppSineFitter::calculateMetrics(const std::array<double,
     
     // Parameter errors (simplified)
     try {
-        auto jacobian = computeJacobian(params);
+        std::vector<double> J(x_data.size() * 4);
+        jacobian(params, J);
         // Simplified error calculation
         for (int i = 0; i < 4; ++i) {
             double sum_sq = 0.0;
             for (size_t j = 0; j < x_data.size(); ++j) {
-                sum_sq += jacobian[j][i] * jacobian[j][i];
+                sum_sq += J[j * 4 + i] * J[j * 4 + i];
             }
             metrics.param_errors[i] = (sum_sq > 0) ? std::sqrt(ss_res / (y_data.size() - 4) / sum_sq) : 0.0;
         }
@@ -394,4 +423,46 @@ CppSineFitter::FitResult CppSineFitter::fit(int num_fit_points) {
     result.fit_time = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
     
     return result;
-}
\ No newline at end of file
+}
+
+std::vector<CppSineFitter::FitResult> CppSineFitter::fitBatch(const std::vector<Series>& series,
+                                                              int num_fit_points, size_t threads) {
+    // Validate everything up front so a bad series fails before any work starts
+    std::vector<CppSineFitter> fitters;
+    fitters.reserve(series.size());
+    for (const auto& s : series) {
+        fitters.emplace_back(s.x, s.y);
+    }
+
+    std::vector<FitResult> results(series.size());
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, series.size());
+
+    std::atomic<size_t> next{0};
+    std::vector<std::exception_ptr> errors(threads);
+    auto work = [&](size_t worker) {
+        try {
+            for (size_t i = next++; i < fitters.size(); i = next++) {
+                results[i] = fitters[i].fit(num_fit_points);
+            }
+        } catch (...) {
+            errors[worker] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(work, t);
+    }
+    if (threads > 0) work(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+    return results;
+}
@@ -9,6 +9,7 @@
 #include <iostream>
 #include <string>
 #include <random>
+#include <span>
 
 class CppSineFitter {
 public:
@@ -35,9 +36,19 @@ public:
         std::array<double, 4> final_params;
     };
 
+    // Non-owning view of one data series
+    struct Series {
+        std::span<const double> x;
+        std::span<const double> y;
+    };
+
 private:
-    std::vector<double> x_data;
-    std::vector<double> y_data;
+    // Owned copies when constructed from vectors; x_data/y_data view either
+    // these or caller-owned memory
+    std::vector<double> x_storage;
+    std::vector<double> y_storage;
+    std::span<const double> x_data;
+    std::span<const double> y_data;
     
     // Validation
     void validateData() const;
@@ -54,8 +65,6 @@ private:
                                                  int max_iter = 300) const;
     
     // Helper functions
-    std::vector<std::vector<double>> computeJacobian(const std::array<double, 4>& params) const;
-    double objective(const std::array<double, 4>& params) const;
     Metrics calculateMetrics(const std::array<double, 4>& params) const;
     
     // FFT-based frequency estimation (simplified version)
@@ -63,6 +72,24 @@ private:
     
 public:
     CppSineFitter(const std::vector<double>& x_data, const std::vector<double>& y_data);
+    // Fits caller-owned data in place; the memory must outlive the fitter
+    CppSineFitter(std::span<const double> x_data, std::span<const double> y_data);
+
+    // Copies would view the source's storage; moves keep the buffers
+    CppSineFitter(const CppSineFitter&) = delete;
+    CppSineFitter& operator=(const CppSineFitter&) = delete;
+    CppSineFitter(CppSineFitter&&) = default;
+
+    size_t size() const { return x_data.size(); }
+
+    // Sum of squared residuals
+    double objective(const std::array<double, 4>& params) const;
+    // Objective for `out.size()` parameter sets stored row-major in `params`
+    void objectiveBatch(std::span<const double> params, std::span<double> out) const;
+    // y - model, one entry per data point
+    void residuals(const std::array<double, 4>& params, std::span<double> out) const;
+    // Model derivatives, size() x 4 row-major (dA, df, dphi, dc)
+    void jacobian(const std::array<double, 4>& params, std::span<double> out) const;
     
     // Static sine model function
     static double sineModel(double x, double amplitude, double frequency, double phase, double offset);
@@ -70,4 +97,8 @@ public:
     
     // Main fitting method
     FitResult fit(int num_fit_points = 300);
+
+    // Fits independent series in parallel; threads == 0 uses every hardware thread
+    static std::vector<FitResult> fitBatch(const std::vector<Series>& series,
+                                           int num_fit_points = 300, size_t threads = 0);
 };
\ No newline at end of file
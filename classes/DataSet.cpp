@@ -0,0 +1,70 @@
+#include "DataSet.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+std::atomic<uint64_t> nextGeneration{1};
+
+}
+
+DataSet::DataSet(std::vector<double> x, std::vector<double> y) {
+    if (x.size() != y.size()) {
+        throw std::invalid_argument("X and Y data vectors must have the same size");
+    }
+    if (x.empty()) return;
+
+    size_t samples = x.size();
+    auto created = std::make_shared<Storage>();
+    created->x = std::move(x);
+    created->y = std::move(y);
+    created->used = samples;
+    created->generation = nextGeneration++;
+    *this = DataSet(std::move(created), samples);
+}
+
+DataSet::DataSet(std::shared_ptr<Storage> shared, size_t samples)
+    : storage(std::move(shared))
+    , count(samples) {
+    // Storage never reallocates once shared, so the pointers stay valid
+    xs = storage->x.data();
+    ys = storage->y.data();
+}
+
+uint64_t DataSet::generation() const {
+    return storage ? storage->generation : 0;
+}
+
+DataSet DataSet::appended(std::span<const double> x, std::span<const double> y) const {
+    if (x.size() != y.size()) {
+        throw std::invalid_argument("X and Y data vectors must have the same size");
+    }
+    if (x.empty()) return *this;
+    if (!storage) {
+        return DataSet(std::vector<double>(x.begin(), x.end()), std::vector<double>(y.begin(), y.end()));
+    }
+
+    size_t total = count + x.size();
+
+    // In place: only the newest snapshot may claim the tail, and only without
+    // a reallocation that would move the samples older snapshots read
+    size_t expected = count;
+    if (total <= storage->x.capacity() && total <= storage->y.capacity() &&
+        storage->used.compare_exchange_strong(expected, total)) {
+        storage->x.insert(storage->x.end(), x.begin(), x.end());
+        storage->y.insert(storage->y.end(), y.begin(), y.end());
+        return DataSet(storage, total);
+    }
+
+    auto grown = std::make_shared<Storage>();
+    size_t capacity = std::max(total, 2 * count);
+    grown->x.reserve(capacity);
+    grown->y.reserve(capacity);
+    grown->x.assign(xs, xs + count);
+    grown->y.assign(ys, ys + count);
+    grown->x.insert(grown->x.end(), x.begin(), x.end());
+    grown->y.insert(grown->y.end(), y.begin(), y.end());
+    grown->used = total;
+    grown->generation = storage->generation;
+    return DataSet(std::move(grown), total);
+}
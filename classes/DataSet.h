@@ -0,0 +1,52 @@
+// DataSet.h - Shared, immutable x/y trace with cheap snapshots and appends
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// One copy of a trace, stored as separate x and y arrays and shared by
+// reference count between the plot and the analysis engines. A DataSet is
+// a snapshot handle: copying it is a pointer copy, and the samples it sees
+// never change, so it can be handed to a worker thread as is.
+//
+// appended() returns a new snapshot. It writes past the end of the shared
+// storage when this snapshot is the newest and capacity allows; the older
+// snapshots only ever read their own prefix. Otherwise it copies into larger
+// storage (grown geometrically), leaving the old one to its snapshots.
+// Appends to one dataset must come from one thread at a time.
+class DataSet {
+public:
+    DataSet() = default;
+    // Takes the arrays without copying; throws std::invalid_argument if
+    // their lengths differ
+    DataSet(std::vector<double> x, std::vector<double> y);
+
+    std::span<const double> x() const { return {xs, count}; }
+    std::span<const double> y() const { return {ys, count}; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Shared by a dataset and everything appended to it; a new dataset gets
+    // a new value (0 when empty). Matches PythonEngine::syncData's contract.
+    uint64_t generation() const;
+
+    DataSet appended(std::span<const double> x, std::span<const double> y) const;
+
+private:
+    struct Storage {
+        std::vector<double> x;
+        std::vector<double> y;
+        std::atomic<size_t> used{0};  // samples written; appends claim past it
+        uint64_t generation = 0;
+    };
+
+    DataSet(std::shared_ptr<Storage> shared, size_t samples);
+
+    std::shared_ptr<Storage> storage;
+    // Cached so readers never touch the vectors an append is growing
+    const double* xs = nullptr;
+    const double* ys = nullptr;
+    size_t count = 0;
+};
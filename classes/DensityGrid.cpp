@@ -0,0 +1,299 @@
+#include "DensityGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Cell indices are computed this many samples at a time
+constexpr size_t kBlock = 1024;
+constexpr uint32_t kOutside = std::numeric_limits<uint32_t>::max();
+
+// Below this, starting a thread costs more than it saves
+constexpr size_t kMinSamplesPerThread = 1 << 18;
+// Cap on the private grids unsorted binning allocates
+constexpr size_t kMaxScratchBytes = size_t(64) << 20;
+
+// Cell sizes this close are the same zoom, up to rounding in the range
+bool sameSize(double a, double b) {
+    return std::abs(a - b) <= 1e-9 * std::abs(b);
+}
+
+// Helper threads for bin(), started on first use and parked between calls,
+// so binning every frame does not create threads every frame. The caller
+// takes parts as well and returns once all of them are done.
+class BinWorkers {
+public:
+    static BinWorkers& instance() {
+        static BinWorkers workers;
+        return workers;
+    }
+
+    void run(size_t parts, const std::function<void(size_t)>& work) {
+        std::lock_guard<std::mutex> serial(runMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &work;
+            jobParts = parts;
+            nextPart = 0;
+            doneParts = 0;
+        }
+        wake.notify_all();
+        takeParts();
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this]() { return doneParts == jobParts; });
+        job = nullptr;
+    }
+
+private:
+    BinWorkers() {
+        size_t helpers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        for (size_t i = 0; i < helpers; ++i) {
+            threads.emplace_back([this]() { loop(); });
+        }
+    }
+
+    ~BinWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this]() { return stopping || (job && nextPart < jobParts); });
+            if (stopping) return;
+            lock.unlock();
+            takeParts();
+            lock.lock();
+        }
+    }
+
+    void takeParts() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (job && nextPart < jobParts) {
+            size_t part = nextPart++;
+            const auto* work = job;
+            lock.unlock();
+            (*work)(part);
+            lock.lock();
+            if (++doneParts == jobParts) finished.notify_all();
+        }
+    }
+
+    std::mutex runMutex;  // one job at a time
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobParts = 0;
+    size_t nextPart = 0;
+    size_t doneParts = 0;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
+
+}
+
+size_t DensityGrid::visibleCount(std::span<const double> x, double keyMin, double keyMax) {
+    auto first = std::lower_bound(x.begin(), x.end(), keyMin);
+    auto last = std::upper_bound(first, x.end(), keyMax);
+    return static_cast<size_t>(last - first);
+}
+
+void DensityGrid::clear() {
+    lattice = {};
+    cells.clear();
+    valid = false;
+    binnedGeneration = 0;
+    binnedCount = 0;
+}
+
+uint32_t DensityGrid::maxCount() const {
+    uint32_t max = 0;
+    for (uint32_t count : cells) max = std::max(max, count);
+    return max;
+}
+
+DensityGrid::Lattice DensityGrid::latticeFor(const Window& window) const {
+    Lattice next;
+    next.width = (window.keyMax - window.keyMin) / static_cast<double>(window.columns);
+    next.height = (window.valueMax - window.valueMin) / static_cast<double>(window.rows);
+    // Keep the old sizes through a pan, so the lattice does not drift
+    if (valid && sameSize(next.width, lattice.width)) next.width = lattice.width;
+    if (valid && sameSize(next.height, lattice.height)) next.height = lattice.height;
+    next.keyOrigin = std::floor(window.keyMin / next.width) * next.width;
+    next.valueOrigin = std::floor(window.valueMin / next.height) * next.height;
+    next.columns = window.columns + 1;
+    next.rows = window.rows + 1;
+    return next;
+}
+
+bool DensityGrid::update(std::span<const double> x, std::span<const double> y, bool ascending, uint64_t generation,
+                         const Window& window) {
+    if (window.columns == 0 || window.rows == 0 || !(window.keyMax > window.keyMin) ||
+        !(window.valueMax > window.valueMin) || x.size() != y.size()) {
+        bool changed = valid;
+        clear();
+        return changed;
+    }
+
+    Lattice next = latticeFor(window);
+    bool sameTrace = valid && generation == binnedGeneration && x.size() >= binnedCount;
+    bool sameCells = valid && next.width == lattice.width && next.height == lattice.height &&
+                     next.columns == lattice.columns && next.rows == lattice.rows &&
+                     next.valueOrigin == lattice.valueOrigin;
+    long long shift = sameCells ? std::llround((next.keyOrigin - lattice.keyOrigin) / next.width) : 0;
+    size_t previous = binnedCount;
+
+    counters.lastBinned = 0;
+    if (sameTrace && sameCells && shift == 0) {
+        if (x.size() == previous) return false;
+        bin(x, y, previous, x.size(), ascending, 0, lattice.columns);
+        ++counters.appends;
+    } else if (sameTrace && sameCells && ascending && std::abs(shift) < static_cast<long long>(lattice.columns)) {
+        shiftColumns(shift);
+        lattice.keyOrigin = next.keyOrigin;
+
+        // The exposed strip, from the samples binned before, then the tail
+        size_t exposed = static_cast<size_t>(std::abs(shift));
+        size_t firstColumn = shift > 0 ? lattice.columns - exposed : 0;
+        size_t lastColumn = shift > 0 ? lattice.columns : exposed;
+        // One column of slack each side; the block's own column test decides
+        double keyMin = lattice.keyOrigin + (static_cast<double>(firstColumn) - 1) * lattice.width;
+        double keyMax = lattice.keyOrigin + (static_cast<double>(lastColumn) + 1) * lattice.width;
+        auto old = x.first(previous);
+        size_t begin = std::lower_bound(old.begin(), old.end(), keyMin) - old.begin();
+        size_t end = std::lower_bound(old.begin() + begin, old.end(), keyMax) - old.begin();
+        bin(x, y, begin, end, ascending, firstColumn, lastColumn);
+        bin(x, y, previous, x.size(), ascending, 0, lattice.columns);
+        ++counters.shifts;
+    } else {
+        lattice = next;
+        cells.assign(lattice.columns * lattice.rows, 0);
+        size_t begin = 0;
+        size_t end = x.size();
+        if (ascending) {
+            double keyMax = lattice.keyOrigin + static_cast<double>(lattice.columns + 1) * lattice.width;
+            begin = std::lower_bound(x.begin(), x.end(), lattice.keyOrigin - lattice.width) - x.begin();
+            end = std::lower_bound(x.begin() + begin, x.end(), keyMax) - x.begin();
+        }
+        bin(x, y, begin, end, ascending, 0, lattice.columns);
+        ++counters.rebuilds;
+    }
+
+    valid = true;
+    binnedGeneration = generation;
+    binnedCount = x.size();
+    return true;
+}
+
+void DensityGrid::shiftColumns(long long shift) {
+    size_t columns = lattice.columns;
+    size_t moved = columns - static_cast<size_t>(std::abs(shift));
+    for (size_t row = 0; row < lattice.rows; ++row) {
+        uint32_t* line = cells.data() + row * columns;
+        if (shift > 0) {
+            // The view moved right: old column `shift` becomes column 0
+            std::copy(line + shift, line + columns, line);
+            std::fill(line + moved, line + columns, 0u);
+        } else {
+            std::copy_backward(line, line + moved, line + columns);
+            std::fill(line, line + (columns - moved), 0u);
+        }
+    }
+}
+
+size_t DensityGrid::columnOf(double key) const {
+    // Same arithmetic as binBlock, so both agree on which column a key is in
+    double column = (key - lattice.keyOrigin) * (1 / lattice.width);
+    return column < 0 ? 0 : static_cast<size_t>(column);
+}
+
+void DensityGrid::binBlock(const double* x, const double* y, size_t count, uint32_t* grid, size_t firstColumn,
+                           size_t lastColumn) const {
+    const double keyOrigin = lattice.keyOrigin;
+    const double valueOrigin = lattice.valueOrigin;
+    const double keyScale = 1 / lattice.width;
+    const double valueScale = 1 / lattice.height;
+    const double columnMin = static_cast<double>(firstColumn);
+    const double columnMax = static_cast<double>(lastColumn);
+    const double rowMax = static_cast<double>(lattice.rows);
+    const int32_t stride = static_cast<int32_t>(lattice.columns);
+
+    uint32_t index[kBlock];
+    for (size_t start = 0; start < count; start += kBlock) {
+        size_t n = std::min(kBlock, count - start);
+        const double* xs = x + start;
+        const double* ys = y + start;
+        // No branches, so this vectorizes; NaN fails every comparison
+        for (size_t i = 0; i < n; ++i) {
+            double column = (xs[i] - keyOrigin) * keyScale;
+            double row = (ys[i] - valueOrigin) * valueScale;
+            bool inside = (column >= columnMin) & (column < columnMax) & (row >= 0) & (row < rowMax);
+            int32_t cell = static_cast<int32_t>(inside ? row : 0) * stride + static_cast<int32_t>(inside ? column : 0);
+            index[i] = inside ? static_cast<uint32_t>(cell) : kOutside;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (index[i] != kOutside) ++grid[index[i]];
+        }
+    }
+}
+
+void DensityGrid::bin(std::span<const double> x, std::span<const double> y, size_t begin, size_t end, bool ascending,
+                      size_t firstColumn, size_t lastColumn) {
+    if (end <= begin) return;
+    size_t count = end - begin;
+    counters.lastBinned += count;
+
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), count / kMinSamplesPerThread);
+    if (!ascending) {
+        size_t gridBytes = cells.size() * sizeof(uint32_t);
+        threads = std::min(threads, std::max<size_t>(1, kMaxScratchBytes / std::max<size_t>(gridBytes, 1)));
+    }
+    if (threads <= 1) {
+        binBlock(x.data() + begin, y.data() + begin, count, cells.data(), firstColumn, lastColumn);
+        return;
+    }
+
+    // Ascending keys: move each split to where the column changes, so the
+    // threads write disjoint columns of the shared grid
+    std::vector<size_t> splits{begin};
+    for (size_t t = 1; t < threads; ++t) {
+        size_t split = std::max(begin + count * t / threads, splits.back());
+        if (ascending) {
+            size_t column = columnOf(x[split]);
+            while (split < end && columnOf(x[split]) == column && split > splits.back()) ++split;
+        }
+        splits.push_back(std::min(split, end));
+    }
+    splits.push_back(end);
+
+    // Unsorted keys: every part but the first gets a private grid
+    std::vector<std::vector<uint32_t>> scratch(ascending ? 0 : threads - 1);
+    std::function<void(size_t)> work = [&](size_t part) {
+        uint32_t* grid = cells.data();
+        if (!ascending && part > 0) {
+            scratch[part - 1].assign(cells.size(), 0);
+            grid = scratch[part - 1].data();
+        }
+        binBlock(x.data() + splits[part], y.data() + splits[part], splits[part + 1] - splits[part], grid, firstColumn,
+                 lastColumn);
+    };
+
+    BinWorkers::instance().run(threads, work);
+
+    for (const auto& grid : scratch) {
+        for (size_t i = 0; i < cells.size(); ++i) cells[i] += grid[i];
+    }
+}
@@ -0,0 +1,83 @@
+// DensityGrid.h - Screen-resolution 2D histogram of a trace, binned in parallel
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Counts the samples in each cell of a grid over a key/value window, one cell
+// per pixel. Cells sit on a fixed lattice (multiples of the cell size from
+// zero), so a pan that keeps the zoom moves whole columns: with ascending
+// keys the columns still in view are kept and only the exposed strip is
+// binned. Samples appended to the same trace are added on their own. Any
+// other change rebins what is visible.
+//
+// Binning computes cell indices branch-free in blocks, which the compiler
+// vectorizes, and splits large ranges across threads: at column boundaries
+// for ascending keys, into private grids otherwise.
+class DensityGrid {
+public:
+    struct Window {
+        double keyMin = 0;
+        double keyMax = 0;
+        double valueMin = 0;
+        double valueMax = 0;
+        size_t columns = 0;  // pixels
+        size_t rows = 0;
+    };
+
+    struct Stats {
+        uint64_t rebuilds = 0;
+        uint64_t shifts = 0;
+        uint64_t appends = 0;
+        size_t lastBinned = 0;  // samples the last update looked at
+    };
+
+    // `generation` identifies the trace as DataSet::generation() does.
+    // Returns false when the grid did not change.
+    bool update(std::span<const double> x, std::span<const double> y, bool ascending, uint64_t generation,
+                const Window& window);
+    void clear();
+
+    // One more column and row than the window, to cover it whatever the
+    // lattice alignment; row 0 is the lowest
+    size_t columns() const { return lattice.columns; }
+    size_t rows() const { return lattice.rows; }
+    double keyOrigin() const { return lattice.keyOrigin; }
+    double valueOrigin() const { return lattice.valueOrigin; }
+    double cellWidth() const { return lattice.width; }
+    double cellHeight() const { return lattice.height; }
+    uint32_t at(size_t column, size_t row) const { return cells[row * lattice.columns + column]; }
+    uint32_t maxCount() const;
+
+    const Stats& stats() const { return counters; }
+
+    // Samples with keys in [keyMin, keyMax]; x must be ascending
+    static size_t visibleCount(std::span<const double> x, double keyMin, double keyMax);
+
+private:
+    struct Lattice {
+        double keyOrigin = 0;
+        double valueOrigin = 0;
+        double width = 0;
+        double height = 0;
+        size_t columns = 0;
+        size_t rows = 0;
+    };
+
+    Lattice latticeFor(const Window& window) const;
+    void shiftColumns(long long shift);
+    // Bins samples [begin, end) that land in columns [firstColumn, lastColumn)
+    void bin(std::span<const double> x, std::span<const double> y, size_t begin, size_t end, bool ascending,
+             size_t firstColumn, size_t lastColumn);
+    void binBlock(const double* x, const double* y, size_t count, uint32_t* grid, size_t firstColumn,
+                  size_t lastColumn) const;
+    size_t columnOf(double key) const;
+
+    Lattice lattice;
+    std::vector<uint32_t> cells;  // row-major
+    bool valid = false;
+    uint64_t binnedGeneration = 0;
+    size_t binnedCount = 0;
+    Stats counters;
+};
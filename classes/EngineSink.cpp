@@ -0,0 +1,15 @@
+#include "EngineSink.h"
+
+StreamSink::StreamSink(std::ostream& output, std::ostream& diagnostics)
+    : output(output), diagnostics(diagnostics) {
+}
+
+void StreamSink::write(Kind kind, std::string_view text) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostream& stream = (kind == Kind::Output) ? output : diagnostics;
+    stream << text << '\n';
+    // Diagnostics are rare and usually precede a failure, so show them now
+    if (kind != Kind::Output) {
+        stream.flush();
+    }
+}
@@ -0,0 +1,37 @@
+// EngineSink.h - Destination for script output and engine diagnostics
+#pragma once
+#include <mutex>
+#include <ostream>
+#include <string_view>
+
+// Everything the Python engine reports goes through a sink, so the engine
+// itself needs no GUI. write() may be called from any thread, including
+// worker threads that hold the GIL: implementations must be thread-safe,
+// cheap, and must never call back into Python or the engine.
+class EngineSink {
+public:
+    enum class Kind {
+        Output,   // script stdout/stderr, one or more whole lines
+        Info,
+        Warning,
+        Error
+    };
+
+    virtual ~EngineSink() = default;
+
+    // `text` carries no trailing newline
+    virtual void write(Kind kind, std::string_view text) = 0;
+};
+
+// Headless sink: script output to one stream, diagnostics to another
+class StreamSink : public EngineSink {
+public:
+    StreamSink(std::ostream& output, std::ostream& diagnostics);
+
+    void write(Kind kind, std::string_view text) override;
+
+private:
+    std::mutex mutex;
+    std::ostream& output;
+    std::ostream& diagnostics;
+};
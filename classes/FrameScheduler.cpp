@@ -0,0 +1,62 @@
+#include "FrameScheduler.h"
+#include <algorithm>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QWindow>
+
+namespace {
+
+// When the screen does not report its refresh rate
+constexpr qreal kFallbackRefreshHz = 60;
+
+}
+
+FrameScheduler::FrameScheduler(QCustomPlot* plot, LayerDirtyTracker* layers, Callback beforeFrame)
+    : plot(plot)
+    , layers(layers)
+    , beforeFrame(std::move(beforeFrame)) {
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, [this]() { renderFrame(); });
+
+    // A full replot, whoever started it, has redrawn every layer
+    connect(plot, &QCustomPlot::afterReplot, this, [this]() { this->layers->clear(); });
+}
+
+void FrameScheduler::schedule() {
+    ++counters.requested;
+    if (timer.isActive()) {
+        ++counters.coalesced;
+        return;
+    }
+    qint64 wait = sinceFrame.isValid() ? frameIntervalMs() - sinceFrame.elapsed() : 0;
+    timer.start(static_cast<int>(std::max<qint64>(wait, 0)));
+}
+
+void FrameScheduler::flush() {
+    if (timer.isActive()) renderFrame();
+}
+
+FrameScheduler::Stats FrameScheduler::stats() const {
+    return counters;
+}
+
+int FrameScheduler::frameIntervalMs() const {
+    QScreen* screen = nullptr;
+    if (QWindow* window = plot->window()->windowHandle()) screen = window->screen();
+    if (!screen) screen = QGuiApplication::primaryScreen();
+    qreal hz = screen && screen->refreshRate() > 0 ? screen->refreshRate() : kFallbackRefreshHz;
+    return std::max(1, qRound(1000.0 / hz));
+}
+
+void FrameScheduler::renderFrame() {
+    timer.stop();
+    if (beforeFrame) beforeFrame();
+    if (!layers->isDirty()) {
+        ++counters.skipped;
+        return;
+    }
+    layers->replot();
+    ++counters.rendered;
+    sinceFrame.restart();
+}
@@ -0,0 +1,49 @@
+// FrameScheduler.h - Coalesces plot updates into at most one replot per frame
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "LayerDirtyTracker.h"
+
+// Mutators mark layers dirty on the tracker and call schedule(); the replot
+// runs from the event loop, no sooner than one display refresh interval
+// after the previous one. A burst of updates (a pair of fits, a live resize,
+// a stream of appends) then costs one replot of whatever it touched.
+//
+// Qt widgets get no vsync signal, so frames are paced by the screen's
+// refresh rate instead. A full replot QCustomPlot does on its own (dragging,
+// its resize handling) leaves nothing dirty, and a frame that finds nothing
+// to do is skipped.
+class FrameScheduler : public QObject {
+public:
+    struct Stats {
+        uint64_t requested = 0;
+        uint64_t coalesced = 0;  // folded into a frame already scheduled
+        uint64_t rendered = 0;
+        uint64_t skipped = 0;    // nothing left to redraw when the frame came
+    };
+
+    using Callback = std::function<void()>;
+
+    // beforeFrame runs first in every frame that will render, for work that
+    // depends on the plot's size; the tracker must outlive the scheduler
+    FrameScheduler(QCustomPlot* plot, LayerDirtyTracker* layers, Callback beforeFrame = {});
+
+    void schedule();
+    // Renders a pending frame now
+    void flush();
+
+    Stats stats() const;
+    int frameIntervalMs() const;
+
+private:
+    void renderFrame();
+
+    QCustomPlot* plot;
+    LayerDirtyTracker* layers;
+    Callback beforeFrame;
+    QTimer timer;
+    QElapsedTimer sinceFrame;
+    Stats counters;
+};
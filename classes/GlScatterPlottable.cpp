@@ -0,0 +1,321 @@
+#include "GlScatterPlottable.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+
+namespace {
+
+// Desktop compatibility-profile enums that QOpenGLFunctions (an ES 2.0 subset)
+// does not define
+constexpr GLenum kProgramPointSize = 0x8642;  // GL_PROGRAM_POINT_SIZE
+constexpr GLenum kPointSprite = 0x8861;       // GL_POINT_SPRITE
+
+// Samples converted to floats per glBufferSubData call
+constexpr size_t kUploadChunk = 1 << 16;
+
+const char* kVertexShader = R"(
+attribute vec2 position;
+uniform vec2 scale;
+uniform vec2 offset;
+uniform float pointSize;
+void main() {
+    gl_Position = vec4(position * scale + offset, 0.0, 1.0);
+    gl_PointSize = pointSize;
+}
+)";
+
+// Premultiplied colours; distances in device pixels from the sprite centre.
+// spriteSize repeats pointSize: ES requires a uniform shared by both stages
+// to have the same precision, which the defaults here do not.
+const char* kFragmentShader = R"(
+#ifdef GL_ES
+precision mediump float;
+#endif
+uniform vec4 fillColor;
+uniform vec4 edgeColor;
+uniform float radius;
+uniform float edgeWidth;
+uniform float spriteSize;
+void main() {
+    float d = length(gl_PointCoord - vec2(0.5)) * spriteSize;
+    float outer = radius + 0.5 * edgeWidth;
+    float inner = radius - 0.5 * edgeWidth;
+    float coverage = 1.0 - smoothstep(outer - 0.5, outer + 0.5, d);
+    float edge = smoothstep(inner - 0.5, inner + 0.5, d);
+    vec4 color = mix(fillColor, edgeColor, edge) * coverage;
+    if (color.a <= 0.0) discard;
+    gl_FragColor = color;
+}
+)";
+
+void setPremultiplied(QOpenGLShaderProgram& program, const char* name, const QColor& color) {
+    float alpha = static_cast<float>(color.alphaF());
+    program.setUniformValue(name, static_cast<float>(color.redF()) * alpha, static_cast<float>(color.greenF()) * alpha,
+                            static_cast<float>(color.blueF()) * alpha, alpha);
+}
+
+}
+
+GlScatterPlottable::GlScatterPlottable(QCPAxis* keyAxis, QCPAxis* valueAxis)
+    : QCPAbstractPlottable(keyAxis, valueAxis) {
+    setSelectable(QCP::stNone);
+}
+
+GlScatterPlottable::~GlScatterPlottable() {
+    if (glContext && glContext->surface()) glContext->makeCurrent(glContext->surface());
+    releaseGl();
+}
+
+void GlScatterPlottable::setData(DataSet data) {
+    bool appended = data.generation() == points.generation() && data.size() >= boundsCount;
+    points = std::move(data);
+    if (!appended) {
+        // Empty until the first finite sample widens them
+        boundsCount = 0;
+        keyBounds = QCPRange(qInf(), -qInf());
+        valueBounds = QCPRange(qInf(), -qInf());
+    }
+    growBounds();
+}
+
+const DataSet& GlScatterPlottable::data() const {
+    return points;
+}
+
+void GlScatterPlottable::setScatterStyle(const QCPScatterStyle& style) {
+    scatter = style;
+}
+
+const QCPScatterStyle& GlScatterPlottable::scatterStyle() const {
+    return scatter;
+}
+
+bool GlScatterPlottable::usingGl() const {
+    return glUsed;
+}
+
+void GlScatterPlottable::growBounds() {
+    auto x = points.x();
+    auto y = points.y();
+    for (size_t i = boundsCount; i < x.size(); ++i) {
+        if (!std::isfinite(x[i]) || !std::isfinite(y[i])) continue;
+        keyBounds.expand(x[i]);
+        valueBounds.expand(y[i]);
+    }
+    boundsCount = x.size();
+}
+
+double GlScatterPlottable::selectTest(const QPointF&, bool, QVariant*) const {
+    return -1;
+}
+
+QCPRange GlScatterPlottable::getKeyRange(bool& foundRange, QCP::SignDomain) const {
+    foundRange = keyBounds.lower <= keyBounds.upper;
+    return keyBounds;
+}
+
+QCPRange GlScatterPlottable::getValueRange(bool& foundRange, QCP::SignDomain, const QCPRange&) const {
+    foundRange = valueBounds.lower <= valueBounds.upper;
+    return valueBounds;
+}
+
+void GlScatterPlottable::drawLegendIcon(QCPPainter* painter, const QRectF& rect) const {
+    applyScattersAntialiasingHint(painter);
+    scatter.applyTo(painter, mPen);
+    scatter.drawShape(painter, rect.center());
+}
+
+void GlScatterPlottable::draw(QCPPainter* painter) {
+    if (points.empty() || !mKeyAxis || !mValueAxis) return;
+    glUsed = drawGl(painter);
+    if (!glUsed) drawWithPainter(painter);
+}
+
+bool GlScatterPlottable::drawGl(QCPPainter* painter) {
+    if (glBroken || !painter->paintEngine() || painter->paintEngine()->type() != QPaintEngine::OpenGL2) return false;
+    if (mKeyAxis->orientation() != Qt::Horizontal || mKeyAxis->scaleType() != QCPAxis::stLinear ||
+        mValueAxis->scaleType() != QCPAxis::stLinear) {
+        return false;
+    }
+
+    painter->beginNativePainting();
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if (!context || !prepareGl(context)) {
+        painter->endNativePainting();
+        return false;
+    }
+    upload();
+
+    // Logical pixel = a * coord + b on each axis, straight from the axes
+    QCPRange keys = mKeyAxis->range();
+    QCPRange values = mValueAxis->range();
+    double keyA = (mKeyAxis->coordToPixel(keys.upper) - mKeyAxis->coordToPixel(keys.lower)) / keys.size();
+    double keyB = mKeyAxis->coordToPixel(keys.lower) - keyA * keys.lower;
+    double valueA = (mValueAxis->coordToPixel(values.upper) - mValueAxis->coordToPixel(values.lower)) / values.size();
+    double valueB = mValueAxis->coordToPixel(values.lower) - valueA * values.lower;
+
+    // The paint buffer covers the viewport; QPainter's y runs down, clip y up
+    GLint viewport[4];
+    gl.glGetIntegerv(GL_VIEWPORT, viewport);
+    QRect plotViewport = mParentPlot->viewport();
+    double width = plotViewport.width();
+    double height = plotViewport.height();
+    double dpr = viewport[2] / width;
+    float scaleX = static_cast<float>(2 * keyA / width);
+    float offsetX = static_cast<float>(2 * (keyA * originKey + keyB - plotViewport.left()) / width - 1);
+    float scaleY = static_cast<float>(-2 * valueA / height);
+    float offsetY = static_cast<float>(1 - 2 * (valueA * originValue + valueB - plotViewport.top()) / height);
+
+    QPen edgePen = scatter.isPenDefined() ? scatter.pen() : mPen;
+    QColor fill = scatter.brush().style() == Qt::NoBrush ? QColor(Qt::transparent) : scatter.brush().color();
+    float radius = static_cast<float>(scatter.size() / 2 * dpr);
+    float edgeWidth = edgePen.style() == Qt::NoPen ? 0.0f : static_cast<float>(std::max(1.0, edgePen.widthF()) * dpr);
+    float pointSize = std::ceil(2 * radius + edgeWidth) + 2;
+
+    QRect clip = clipRect().translated(-plotViewport.topLeft());
+    gl.glEnable(GL_SCISSOR_TEST);
+    gl.glScissor(static_cast<GLint>(clip.left() * dpr), static_cast<GLint>(viewport[3] - (clip.top() + clip.height()) * dpr),
+                 static_cast<GLsizei>(clip.width() * dpr), static_cast<GLsizei>(clip.height() * dpr));
+    gl.glEnable(GL_BLEND);
+    gl.glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    if (!context->isOpenGLES()) {
+        // Needed for gl_PointSize and gl_PointCoord in a compatibility profile;
+        // a core profile rejects the sprite enum, which is harmless
+        gl.glEnable(kProgramPointSize);
+        gl.glEnable(kPointSprite);
+        while (gl.glGetError() != GL_NO_ERROR) {}
+    }
+
+    program->bind();
+    program->setUniformValue("scale", scaleX, scaleY);
+    program->setUniformValue("offset", offsetX, offsetY);
+    program->setUniformValue("pointSize", pointSize);
+    program->setUniformValue("spriteSize", pointSize);
+    program->setUniformValue("radius", radius);
+    program->setUniformValue("edgeWidth", edgeWidth);
+    setPremultiplied(*program, "fillColor", fill);
+    setPremultiplied(*program, "edgeColor", edgePen.color());
+
+    gl.glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    program->enableAttributeArray("position");
+    program->setAttributeBuffer("position", GL_FLOAT, 0, 2);
+    gl.glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(uploadedCount));
+    program->disableAttributeArray("position");
+    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+    program->release();
+    gl.glDisable(GL_SCISSOR_TEST);
+    if (!context->isOpenGLES()) {
+        // QPainter's engine draws points too and does not expect sprites
+        gl.glDisable(kProgramPointSize);
+        gl.glDisable(kPointSprite);
+        while (gl.glGetError() != GL_NO_ERROR) {}
+    }
+
+    painter->endNativePainting();
+    return true;
+}
+
+bool GlScatterPlottable::prepareGl(QOpenGLContext* context) {
+    if (context == glContext && program) return true;
+
+    releaseGl();
+    glContext = context;
+    gl.initializeOpenGLFunctions();
+    // Emitted before the context goes, which it does not make current itself
+    contextDestroyed = QObject::connect(context, &QOpenGLContext::aboutToBeDestroyed, context, [this]() {
+        if (glContext->surface()) glContext->makeCurrent(glContext->surface());
+        releaseGl();
+    }, Qt::DirectConnection);
+
+    QByteArray version = context->isOpenGLES() ? "#version 100\n" : "#version 120\n";
+    program = std::make_unique<QOpenGLShaderProgram>();
+    if (!program->addShaderFromSourceCode(QOpenGLShader::Vertex, version + kVertexShader) ||
+        !program->addShaderFromSourceCode(QOpenGLShader::Fragment, version + kFragmentShader) ||
+        !program->link()) {
+        qWarning() << "GlScatterPlottable: falling back to QPainter:" << program->log();
+        glBroken = true;
+        releaseGl();
+        return false;
+    }
+
+    gl.glGenBuffers(1, &vertexBuffer);
+    bufferCapacity = uploadedCount = 0;
+    uploadedGeneration = 0;
+    return true;
+}
+
+void GlScatterPlottable::upload() {
+    auto x = points.x();
+    auto y = points.y();
+    bool appended = uploadedCount > 0 && points.generation() == uploadedGeneration && x.size() >= uploadedCount;
+    size_t from = appended ? uploadedCount : 0;
+    if (from == x.size() && appended) return;
+
+    gl.glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    if (!appended) {
+        // From the first finite sample: a NaN or Inf origin would make every vertex NaN
+        originKey = originValue = 0;
+        for (size_t i = 0; i < x.size(); ++i) {
+            if (std::isfinite(x[i]) && std::isfinite(y[i])) {
+                originKey = x[i];
+                originValue = y[i];
+                break;
+            }
+        }
+    }
+    if (x.size() > bufferCapacity) {
+        // Grown geometrically so a stream of appends reallocates rarely
+        bufferCapacity = appended ? std::max(x.size(), 2 * bufferCapacity) : x.size();
+        gl.glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(bufferCapacity * 2 * sizeof(float)), nullptr,
+                        GL_DYNAMIC_DRAW);
+        from = 0;
+    }
+
+    std::vector<float> chunk;
+    chunk.reserve(2 * std::min(kUploadChunk, x.size() - from));
+    for (size_t begin = from; begin < x.size(); begin += kUploadChunk) {
+        size_t end = std::min(begin + kUploadChunk, x.size());
+        chunk.clear();
+        for (size_t i = begin; i < end; ++i) {
+            chunk.push_back(static_cast<float>(x[i] - originKey));
+            chunk.push_back(static_cast<float>(y[i] - originValue));
+        }
+        gl.glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(begin * 2 * sizeof(float)),
+                           static_cast<GLsizeiptr>(chunk.size() * sizeof(float)), chunk.data());
+    }
+    gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    uploadedCount = x.size();
+    uploadedGeneration = points.generation();
+}
+
+void GlScatterPlottable::releaseGl() {
+    if (!glContext) return;
+    QObject::disconnect(contextDestroyed);
+
+    // The buffer can only be deleted with its context current; otherwise it
+    // is freed along with the context. The program defers that itself.
+    if (vertexBuffer && QOpenGLContext::currentContext() == glContext) gl.glDeleteBuffers(1, &vertexBuffer);
+    program.reset();
+    vertexBuffer = 0;
+    bufferCapacity = uploadedCount = 0;
+    uploadedGeneration = 0;
+    glContext = nullptr;
+}
+
+void GlScatterPlottable::drawWithPainter(QCPPainter* painter) const {
+    // QCPGraph's path, minus the container: cull to the visible ranges
+    QCPRange keys = mKeyAxis->range();
+    QCPRange values = mValueAxis->range();
+    auto x = points.x();
+    auto y = points.y();
+
+    applyScattersAntialiasingHint(painter);
+    scatter.applyTo(painter, mPen);
+    for (size_t i = 0; i < x.size(); ++i) {
+        if (!keys.contains(x[i]) || !values.contains(y[i])) continue;
+        scatter.drawShape(painter, mKeyAxis->coordToPixel(x[i]), mValueAxis->coordToPixel(y[i]));
+    }
+}
@@ -0,0 +1,76 @@
+// GlScatterPlottable.h - Scatter plottable drawn with a single OpenGL call
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <QOpenGLFunctions>
+#include "DataSet.h"
+#include "qcustomplot_wrapper.h"
+
+class QOpenGLContext;
+class QOpenGLShaderProgram;
+
+// QCPGraph paints one QPainter ellipse per point, which on QCustomPlot's
+// OpenGL paint buffer is one tessellated path per point. This plottable
+// uploads the trace into a vertex buffer once (appending to the same dataset
+// uploads only the new samples) and draws every point as a point sprite,
+// shaded into the scatter style's circle, with one glDrawArrays. Pan and
+// zoom change nothing but the transform uniforms.
+//
+// The shaders are GLSL 1.20 / GLSL ES 1.00 without extensions, so Mesa's
+// llvmpipe runs them. Where the plot does not paint through OpenGL, the axes
+// are not linear or the shaders fail to build, points are painted with
+// QPainter instead. Not selectable; value ranges ignore the key range.
+class GlScatterPlottable : public QCPAbstractPlottable {
+public:
+    GlScatterPlottable(QCPAxis* keyAxis, QCPAxis* valueAxis);
+    ~GlScatterPlottable() override;
+
+    void setData(DataSet data);
+    const DataSet& data() const;
+    // Drawn as a circle whatever the shape; size, pen and brush are used
+    void setScatterStyle(const QCPScatterStyle& style);
+    const QCPScatterStyle& scatterStyle() const;
+
+    // Whether the last replot drew through OpenGL
+    bool usingGl() const;
+
+    double selectTest(const QPointF& pos, bool onlySelectable, QVariant* details = nullptr) const override;
+    QCPRange getKeyRange(bool& foundRange, QCP::SignDomain inSignDomain = QCP::sdBoth) const override;
+    QCPRange getValueRange(bool& foundRange, QCP::SignDomain inSignDomain = QCP::sdBoth,
+                           const QCPRange& inKeyRange = QCPRange()) const override;
+
+protected:
+    void draw(QCPPainter* painter) override;
+    void drawLegendIcon(QCPPainter* painter, const QRectF& rect) const override;
+
+private:
+    bool drawGl(QCPPainter* painter);
+    void drawWithPainter(QCPPainter* painter) const;
+    bool prepareGl(QOpenGLContext* context);
+    void upload();
+    void releaseGl();
+    void growBounds();
+
+    DataSet points;
+    QCPScatterStyle scatter;
+    // Bounds of the first boundsCount samples, extended on append
+    QCPRange keyBounds;
+    QCPRange valueBounds;
+    size_t boundsCount = 0;
+
+    // Tied to the context they were created in
+    QOpenGLContext* glContext = nullptr;
+    QMetaObject::Connection contextDestroyed;
+    QOpenGLFunctions gl;
+    std::unique_ptr<QOpenGLShaderProgram> program;
+    GLuint vertexBuffer = 0;
+    size_t bufferCapacity = 0;  // samples
+    size_t uploadedCount = 0;
+    uint64_t uploadedGeneration = 0;
+    // Subtracted before narrowing to float, so a trace far from zero keeps
+    // its precision
+    double originKey = 0;
+    double originValue = 0;
+    bool glBroken = false;
+    bool glUsed = false;
+};
@@ -0,0 +1,48 @@
+#include "GraphDataFill.h"
+#include <stdexcept>
+
+namespace {
+
+// QVector storage is implicitly shared, so set() adopts it without copying
+QSharedPointer<QCPGraphDataContainer> adopt(const QVector<QCPGraphData>& points, bool sorted) {
+    auto container = QSharedPointer<QCPGraphDataContainer>::create();
+    container->set(points, sorted);
+    return container;
+}
+
+}
+
+QSharedPointer<QCPGraphDataContainer> GraphDataFill::fromSpans(std::span<const double> x, std::span<const double> y,
+                                                               Order order) {
+    if (x.size() != y.size()) {
+        throw std::invalid_argument("X and Y data vectors must have the same size");
+    }
+
+    QVector<QCPGraphData> points(static_cast<int>(x.size()));
+    QCPGraphData* out = points.data();
+    bool sorted = true;
+    for (size_t i = 0; i < x.size(); ++i) {
+        out[i].key = x[i];
+        out[i].value = y[i];
+        if (order == Order::Unknown && i > 0 && x[i] < x[i - 1]) sorted = false;
+    }
+    return adopt(points, sorted);
+}
+
+QSharedPointer<QCPGraphDataContainer> GraphDataFill::fromIndices(std::span<const double> x, std::span<const double> y,
+                                                                 std::span<const size_t> indices, Order order) {
+    if (x.size() != y.size()) {
+        throw std::invalid_argument("X and Y data vectors must have the same size");
+    }
+
+    QVector<QCPGraphData> points(static_cast<int>(indices.size()));
+    QCPGraphData* out = points.data();
+    bool sorted = true;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        size_t index = indices[i];
+        out[i].key = x[index];
+        out[i].value = y[index];
+        if (order == Order::Unknown && i > 0 && out[i].key < out[i - 1].key) sorted = false;
+    }
+    return adopt(points, sorted);
+}
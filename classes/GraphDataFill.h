@@ -0,0 +1,23 @@
+// GraphDataFill.h - One-pass filling of QCustomPlot graph containers
+#pragma once
+#include <span>
+#include "qcustomplot_wrapper.h"
+
+// QCPGraph::setData(QVector, QVector) copies twice and always sorts. These
+// build the container's storage directly from parallel arrays; the result is
+// handed to QCPGraph::setData(QSharedPointer), which takes it without a copy.
+class GraphDataFill {
+public:
+    enum class Order {
+        Unknown,    // keys are checked while copying, sorted only if needed
+        Ascending   // caller guarantees sorted keys
+    };
+
+    // Throws std::invalid_argument if x and y differ in length
+    static QSharedPointer<QCPGraphDataContainer> fromSpans(std::span<const double> x, std::span<const double> y,
+                                                           Order order = Order::Unknown);
+    // A subset of samples, e.g. a level-of-detail view; indices ascending
+    static QSharedPointer<QCPGraphDataContainer> fromIndices(std::span<const double> x, std::span<const double> y,
+                                                             std::span<const size_t> indices,
+                                                             Order order = Order::Unknown);
+};
@@ -0,0 +1,65 @@
+#include "IncrementalColorMap.h"
+
+IncrementalColorMap::IncrementalColorMap(QCPAxis* keyAxis, QCPAxis* valueAxis)
+    : QCPColorMap(keyAxis, valueAxis) {
+}
+
+void IncrementalColorMap::cellsChanged(const QRect& cells) {
+    dirty = dirty.united(cells);
+}
+
+void IncrementalColorMap::recolorAll() {
+    mMapImageInvalidated = true;
+}
+
+bool IncrementalColorMap::partialPossible() const {
+    QCPAxis* keys = keyAxis();
+    if (!keys || mMapImageInvalidated || mMapImage.isNull()) return false;
+    int keySize = mMapData->keySize();
+    int valueSize = mMapData->valueSize();
+    // Small maps are drawn from a scaled-up copy of the image (see
+    // QCPColorMap::updateMapImage); those are cheap to redo in full anyway
+    if (!mInterpolate && (keySize <= 100 || valueSize <= 100)) return false;
+    QSize expected = keys->orientation() == Qt::Horizontal ? QSize(keySize, valueSize) : QSize(valueSize, keySize);
+    return mMapImage.size() == expected;
+}
+
+void IncrementalColorMap::updateMapImage() {
+    QRect cells = dirty & QRect(0, 0, mMapData->keySize(), mMapData->valueSize());
+    dirty = QRect();
+
+    // Past half the map, colorizing it all in parallel bands is faster
+    qint64 total = qint64(mMapData->keySize()) * mMapData->valueSize();
+    if (!partialPossible() || qint64(cells.width()) * cells.height() * 2 > total) {
+        QCPColorMap::updateMapImage();
+        return;
+    }
+    // The data's modified flag is out of reach here, so every draw lands
+    // here until the next full recolor; with nothing reported it is a no-op
+    if (!cells.isEmpty()) colorizeCells(cells);
+}
+
+void IncrementalColorMap::colorizeCells(const QRect& cells) {
+    const bool logarithmic = mDataScaleType == QCPAxis::stLogarithmic;
+    const bool horizontal = keyAxis()->orientation() == Qt::Horizontal;
+    // Scanlines run along the key on a horizontal key axis, along the value
+    // otherwise; the image's first scanline is the last key or value
+    const int lines = horizontal ? mMapData->valueSize() : mMapData->keySize();
+    const int firstLine = horizontal ? cells.top() : cells.left();
+    const int lastLine = horizontal ? cells.bottom() : cells.right();
+    const int firstCell = horizontal ? cells.left() : cells.top();
+    const int count = horizontal ? cells.width() : cells.height();
+
+    lineData.resize(static_cast<size_t>(count));
+    lineAlpha.resize(static_cast<size_t>(count));
+    for (int line = firstLine; line <= lastLine; ++line) {
+        for (int i = 0; i < count; ++i) {
+            int key = horizontal ? firstCell + i : line;
+            int value = horizontal ? line : firstCell + i;
+            lineData[i] = mMapData->cell(key, value);
+            lineAlpha[i] = mMapData->alpha(key, value);  // 255 without an alpha map
+        }
+        QRgb* pixels = reinterpret_cast<QRgb*>(mMapImage.scanLine(lines - 1 - line)) + firstCell;
+        mGradient.colorize(lineData.data(), lineAlpha.data(), mDataRange, pixels, count, 1, logarithmic);
+    }
+}
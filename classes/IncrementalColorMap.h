@@ -0,0 +1,34 @@
+// IncrementalColorMap.h - Color map that recolors only the cells reported changed
+#pragma once
+#include <vector>
+#include <QRect>
+#include "qcustomplot_wrapper.h"
+
+// QCPColorMap recolors its whole image whenever any cell changed. Writers
+// of this one report the cells they set (cellsChanged), and the next replot
+// colorizes just those into the existing image, so a map that changes a
+// column at a time costs a column per frame. Whatever affects every cell
+// (size, gradient, data range or scale, interpolation) still recolors all
+// of them, as do changes covering most of the map.
+//
+// Cells set through data() without a report are only picked up by the next
+// full recolor; recolorAll() forces one.
+class IncrementalColorMap : public QCPColorMap {
+public:
+    IncrementalColorMap(QCPAxis* keyAxis, QCPAxis* valueAxis);
+
+    // `cells` in cell indices: x along the key, y along the value
+    void cellsChanged(const QRect& cells);
+    void recolorAll();
+
+protected:
+    void updateMapImage() override;
+
+private:
+    bool partialPossible() const;
+    void colorizeCells(const QRect& cells);
+
+    QRect dirty;
+    std::vector<double> lineData;
+    std::vector<unsigned char> lineAlpha;
+};
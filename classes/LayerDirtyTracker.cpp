@@ -0,0 +1,56 @@
+#include "LayerDirtyTracker.h"
+#include <algorithm>
+
+LayerDirtyTracker::LayerDirtyTracker(QCustomPlot* plot)
+    : plot(plot) {
+}
+
+void LayerDirtyTracker::invalidate(QCPLayer* layer) {
+    if (allDirty) return;
+    if (layer->mode() != QCPLayer::lmBuffered) {
+        // Shares a buffer with its neighbours, which would be wiped too
+        invalidateAll();
+        return;
+    }
+    if (std::find(dirty.begin(), dirty.end(), layer) == dirty.end()) dirty.push_back(layer);
+}
+
+void LayerDirtyTracker::invalidateAll() {
+    allDirty = true;
+    dirty.clear();
+}
+
+bool LayerDirtyTracker::isDirty() const {
+    return allDirty || !dirty.empty();
+}
+
+void LayerDirtyTracker::clear() {
+    if (replotting) {
+        // A layer fell back to a full replot, which covered the rest
+        fullReplotDone = true;
+        return;
+    }
+    allDirty = false;
+    dirty.clear();
+}
+
+void LayerDirtyTracker::replot() {
+    if (allDirty) {
+        plot->replot();
+        clear();
+        return;
+    }
+    // A layer falls back to a full replot by itself if the buffers were
+    // invalidated, e.g. by a resize or a layer change; its afterReplot
+    // lands in clear() while the loop still runs
+    std::vector<QCPLayer*> layers;
+    layers.swap(dirty);
+    replotting = true;
+    fullReplotDone = false;
+    for (QCPLayer* layer : layers) {
+        layer->replot();
+        if (fullReplotDone) break;
+    }
+    replotting = false;
+    clear();
+}
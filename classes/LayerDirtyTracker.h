@@ -0,0 +1,31 @@
+// LayerDirtyTracker.h - Replots only the plot layers whose contents changed
+#pragma once
+#include <vector>
+#include "qcustomplot_wrapper.h"
+
+// QCustomPlot::replot redraws every layer. A layer in lmBuffered mode has a
+// paint buffer of its own and QCPLayer::replot redraws just that buffer,
+// leaving the others to be composited as they are. Mutators mark the layers
+// they touched; replot() then redraws only those. Anything that moves every
+// layer (ranges, layout) goes through invalidateAll() and a full replot, as
+// does a dirty layer that is not buffered.
+class LayerDirtyTracker {
+public:
+    explicit LayerDirtyTracker(QCustomPlot* plot);
+
+    void invalidate(QCPLayer* layer);
+    void invalidateAll();
+    bool isDirty() const;
+    // Forgets the marks, e.g. after a full replot started elsewhere; during
+    // replot() it only notes that one happened
+    void clear();
+
+    void replot();
+
+private:
+    QCustomPlot* plot;
+    std::vector<QCPLayer*> dirty;
+    bool allDirty = false;
+    bool replotting = false;
+    bool fullReplotDone = false;
+};
@@ -3,9 +3,32 @@
 #include <fstream>
 #include <sstream>
 #include <chrono>
+#include <future>
 
 #include "PlotWidgetImpl.h"
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QInputDialog>
+#include <QtCore/QDateTime>
+
+namespace {
+
+// Shows formatted text but sorts by the numeric value in Qt::UserRole
+class NumericTableItem : public QTableWidgetItem {
+public:
+    NumericTableItem(double value, const QString& text) : QTableWidgetItem(text) {
+        setData(Qt::UserRole, value);
+        setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    }
+
+    bool operator<(const QTableWidgetItem& other) const override {
+        return data(Qt::UserRole).toDouble() < other.data(Qt::UserRole).toDouble();
+    }
+};
 
+// Rows beyond this are mostly sub-microsecond noise and slow the table down
+constexpr int kMaxProfileRows = 500;
+
+}
 
 MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     setWindowTitle("Data Analysis Tool - Sine Curve Fitting with C++ and Python Comparison");
@@ -16,13 +39,38 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
 
     setupUI();
 
-    pythonEngine.setOutputWidget(outputTextEdit);
+    outputSink = std::make_shared<QtEngineSink>(outputTextEdit);
+    pythonEngine.setSink(outputSink);
+
+    // A runaway script is cancelled long before the GUI process runs out of memory
+    PythonEngine::MemoryLimits limits;
+    limits.softBytes = size_t(1) << 30;
+    limits.hardBytes = size_t(4) << 30;
+    pythonEngine.setMemoryLimits(limits);
+
+    // Python output streams into a ring buffer; the sink batches what is
+    // drained here into at most one widget update per interval
+    outputDrainTimer = new QTimer(this);
+    outputDrainTimer->setInterval(50);
+    connect(outputDrainTimer, &QTimer::timeout, this, [this]() {
+        pythonEngine.drainOutput();
+    });
+    outputDrainTimer->start();
 
     statusLabel->setText("Ready. Choose Python or C++ analysis, or compare both.");
     outputTextEdit->append("=== Data Analysis Tool Output ===");
     outputTextEdit->append("Ready to load and execute Python scripts or run C++ fitting.");
     outputTextEdit->append("");
 
+    // Start the interpreter once the window is up; heavy imports continue in the background
+    QTimer::singleShot(0, this, [this]() {
+        try {
+            pythonEngine.prewarm();
+        } catch (const std::exception& e) {
+            outputTextEdit->append(QString("Python pre-warm failed: %1").arg(e.what()));
+        }
+    });
+
     // Center window
     QScreen* screen = QApplication::primaryScreen();
     if (screen) {
@@ -72,15 +120,34 @@ void MainWindow::setupUI() {
         "}"
     );
     tabWidget->addTab(outputTextEdit, "Output");
+    // Add profile tab: phase summary above sortable function and line tables
+    QWidget* profileTab = new QWidget(this);
+    QVBoxLayout* profileLayout = new QVBoxLayout(profileTab);
+    profileSummaryLabel = new QLabel("Choose a profile mode and run a Python analysis to see where the time goes.", profileTab);
+    profileSummaryLabel->setWordWrap(true);
+    profileTable = new QTableWidget(0, 6, profileTab);
+    profileTable->setHorizontalHeaderLabels({"Function", "Location", "Calls", "Total (ms)", "Self (ms)", "Self %"});
+    // Line times include the calls made from the line, so they get their own
+    // table rather than a self time they do not have
+    profileLinesTable = new QTableWidget(0, 4, profileTab);
+    profileLinesTable->setHorizontalHeaderLabels({"Line", "Hits", "Total (ms)", "Total %"});
+    for (QTableWidget* table : {profileTable, profileLinesTable}) {
+        table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        table->setSelectionBehavior(QAbstractItemView::SelectRows);
+        table->verticalHeader()->setVisible(false);
+        table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+        table->setSortingEnabled(true);
+    }
+    profileLayout->addWidget(profileSummaryLabel);
+    profileLayout->addWidget(profileTable, 2);
+    profileLayout->addWidget(profileLinesTable, 1);
+    tabWidget->addTab(profileTab, "Profile");
     // Create and attach the syntax highlighter
     pythonHighlighter = new PythonHighlighter(scriptEditor->document());
 
     // Replace the outputTextEdit addition with tabWidget
     rightSplitter->addWidget(tabWidget);
 
-    // Set the output widget for the Python engine
-    pythonEngine.setOutputWidget(outputTextEdit);
-
     outputTextEdit = new QTextEdit(this);
     outputTextEdit->setReadOnly(true);
     outputTextEdit->setMinimumSize(300, 200);
@@ -131,6 +198,8 @@ void MainWindow::setupUI() {
     clearOutputButton = new QPushButton("Clear Output", this);
     saveScriptButton = new QPushButton("Save Script", this);
     compareFittingButton = new QPushButton("Compare Python vs C++", this);
+    benchmarkButton = new QPushButton("Benchmark Python vs C++", this);
+    benchmarkButton->setToolTip("Time both fitters over warm-up and repeated runs, per phase, with output muted");
 
     // Style the comparison button
     compareFittingButton->setStyleSheet(
@@ -143,7 +212,26 @@ void MainWindow::setupUI() {
 
     buttonLayout2->addWidget(clearOutputButton);
     buttonLayout2->addWidget(saveScriptButton);
+    sessionCheckBox = new QCheckBox("Persistent Python session", this);
+    sessionCheckBox->setToolTip("Keep script variables between runs instead of starting each run in a fresh namespace");
+    outOfProcessCheckBox = new QCheckBox("Run Python out of process", this);
+    outOfProcessCheckBox->setToolTip("Run the script in an isolated worker process; data is shared through shared memory");
+    workerDaemonCheckBox = new QCheckBox("Shared warm workers", this);
+    workerDaemonCheckBox->setToolTip("Borrow pre-started workers from a background daemon shared by all instances; "
+                                     "it exits after 10 minutes without work");
+    workerDaemonCheckBox->setEnabled(false);
+
     buttonLayout2->addWidget(compareFittingButton);
+    buttonLayout2->addWidget(benchmarkButton);
+    buttonLayout2->addWidget(sessionCheckBox);
+    buttonLayout2->addWidget(outOfProcessCheckBox);
+    buttonLayout2->addWidget(workerDaemonCheckBox);
+    profileModeCombo = new QComboBox(this);
+    profileModeCombo->addItem("Profile: Off");
+    profileModeCombo->addItem("Profile: Functions");
+    profileModeCombo->addItem("Profile: Lines");
+    profileModeCombo->setToolTip("Time each Python function (and script line) during embedded runs; results go to the Profile tab");
+    buttonLayout2->addWidget(profileModeCombo);
     buttonLayout2->addStretch();
 
     controlMainLayout->addWidget(buttonRow1);
@@ -171,9 +259,21 @@ void MainWindow::setupUI() {
     QObject::connect(runAnalysisButton, &QPushButton::clicked, this, &MainWindow::onRunAnalysis);
     QObject::connect(runCppAnalysisButton, &QPushButton::clicked, this, &MainWindow::onRunCppAnalysis);
     QObject::connect(compareFittingButton, &QPushButton::clicked, this, &MainWindow::onCompareFitting);
+    QObject::connect(benchmarkButton, &QPushButton::clicked, this, &MainWindow::onRunBenchmark);
     QObject::connect(regenerateButton, &QPushButton::clicked, this, &MainWindow::onRegenerateData);
     QObject::connect(clearOutputButton, &QPushButton::clicked, this, &MainWindow::onClearOutput);
+    QObject::connect(profileModeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        static const PythonEngine::ProfileMode modes[] = {
+            PythonEngine::ProfileMode::Off, PythonEngine::ProfileMode::Functions, PythonEngine::ProfileMode::Lines
+        };
+        pythonEngine.setProfileMode(modes[index]);
+    });
     QObject::connect(saveScriptButton, &QPushButton::clicked, this, &MainWindow::onSaveScript);
+    QObject::connect(sessionCheckBox, &QCheckBox::toggled, this, &MainWindow::onSessionModeToggled);
+    QObject::connect(outOfProcessCheckBox, &QCheckBox::toggled, workerDaemonCheckBox, &QCheckBox::setEnabled);
+    QObject::connect(workerDaemonCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        pythonEngine.setWorkerDaemon(checked ? PythonWorkerPool::defaultDaemonSocket() : std::string());
+    });
 }
 
 // Add new method for saving script
@@ -237,7 +337,8 @@ void MainWindow::onRunAnalysis() {
             return;
         }
 
-        if (!pythonEngine.isInitialized()) {
+        bool out_of_process = outOfProcessCheckBox->isChecked();
+        if (!out_of_process && !pythonEngine.isInitialized()) {
             statusLabel->setText("Initializing Python...");
             outputTextEdit->append("Initializing Python engine...");
             QApplication::processEvents();
@@ -245,45 +346,77 @@ void MainWindow::onRunAnalysis() {
         }
 
         statusLabel->setText("Running Python analysis...");
-        outputTextEdit->append("Running Python analysis script...");
+        outputTextEdit->append(out_of_process ? "Running Python analysis script in a worker process..."
+                                              : "Running Python analysis script...");
         QApplication::processEvents();
 
         auto start_time = std::chrono::high_resolution_clock::now();
 
-        auto x_data = plotWidget->getXData();
-        auto y_data = plotWidget->getYData();
-        pythonEngine.setData(x_data, y_data);
-        pythonEngine.executeScript(currentScript.toStdString());
+        // A snapshot: later appends or regenerations do not touch it
+        auto data = plotWidget->dataSet();
+        auto x_data = data.x();
+        auto y_data = data.y();
+
+        CppSineFitter::FitResult result;
+        bool has_result = true;
+        std::string result_error;
+
+        if (out_of_process) {
+            // A crashing script only takes down its worker process
+            std::string script = currentScript.toStdString();
+            std::vector<PythonWorkerPool::JobResult> jobs;
+            runPythonTask([&]() { jobs = pythonEngine.map(script, {{x_data, y_data}}); });
+            has_result = jobs.front().ok;
+            if (has_result) {
+                result = std::move(jobs.front().fit);
+            } else {
+                result_error = jobs.front().error;
+            }
+        } else {
+            std::string script = currentScript.toStdString();
+            runPythonTask([&]() {
+                // Unchanged data is not re-sent; appended samples only extend it
+                pythonEngine.syncData(data);
+                pythonEngine.executeScript(script);
+            });
+        }
 
         auto end_time = std::chrono::high_resolution_clock::now();
         auto python_time = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
 
-        auto fit_x = pythonEngine.getArray("fit_x");
-        auto fit_y = pythonEngine.getArray("fit_y");
+        if (!out_of_process) {
+            try {
+                result = pythonEngine.getFitResult();
+            } catch (const std::exception& e) {
+                has_result = false;
+                result_error = e.what();
+            }
+            flushPythonOutput();
+            if (pythonEngine.profileMode() != PythonEngine::ProfileMode::Off) {
+                displayProfile(pythonEngine.lastProfile(), currentScript);
+            }
+        }
 
-        if (!fit_x.empty() && !fit_y.empty()) {
-            // plotWidget->setFitData(fit_x, fit_y);
-            plotWidget->setPythonFitData(fit_x, fit_y);
+        if (!has_result) {
+            statusLabel->setText("Analysis completed but no valid fit data returned");
+            outputTextEdit->append(QString("Warning: %1").arg(QString::fromStdString(result_error)));
+        }
 
-            double amplitude = pythonEngine.getScalar("amplitude");
-            double frequency = pythonEngine.getScalar("frequency");
-            double phase = pythonEngine.getScalar("phase");
+        if (has_result) {
+            plotWidget->setPythonFitData(result.fit_x, result.fit_y);
 
             statusLabel->setText(QString("Python Analysis complete. Fitted: A=%1, f=%2, φ=%3 (Time: %4 µs)")
-                               .arg(QString::number(amplitude, 'f', 3))
-                               .arg(QString::number(frequency, 'f', 3))
-                               .arg(QString::number(phase, 'f', 3))
+                               .arg(QString::number(result.amplitude, 'f', 3))
+                               .arg(QString::number(result.frequency, 'f', 3))
+                               .arg(QString::number(result.phase, 'f', 3))
                                .arg(python_time.count()));
 
             outputTextEdit->append("=== Python Results ===");
-            outputTextEdit->append(QString("Amplitude: %1").arg(QString::number(amplitude, 'f', 3)));
-            outputTextEdit->append(QString("Frequency: %1").arg(QString::number(frequency, 'f', 3)));
-            outputTextEdit->append(QString("Phase: %1").arg(QString::number(phase, 'f', 3)));
+            outputTextEdit->append(QString("Amplitude: %1").arg(QString::number(result.amplitude, 'f', 3)));
+            outputTextEdit->append(QString("Frequency: %1").arg(QString::number(result.frequency, 'f', 3)));
+            outputTextEdit->append(QString("Phase: %1").arg(QString::number(result.phase, 'f', 3)));
             outputTextEdit->append(QString("Execution Time: %1 microseconds").arg(python_time.count()));
             outputTextEdit->append("Plot updated with fitted curve.");
-        } else {
-            statusLabel->setText("Analysis completed but no fit data returned");
-            outputTextEdit->append("Warning: No fit data returned from Python script");
         }
 
         outputTextEdit->append("=== Python Analysis Complete ===");
@@ -318,9 +451,86 @@ void MainWindow::onRunCppAnalysis() {
     }
 }
 
+void MainWindow::displayProfile(const PythonEngine::ProfileReport& report, const QString& script) {
+    auto ms = [](auto duration) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 1e6;
+    };
+    double executeMs = ms(report.execute);
+
+    QString summary = QString("Marshal in %1 ms | Compile %2 ms | Execute %3 ms | Marshal out %4 ms")
+                          .arg(QString::number(ms(report.marshalIn), 'f', 3))
+                          .arg(QString::number(ms(report.compile), 'f', 3))
+                          .arg(QString::number(executeMs, 'f', 3))
+                          .arg(QString::number(ms(report.marshalOut), 'f', 3));
+    profileSummaryLabel->setText(summary);
+    outputTextEdit->append("Profile: " + summary + " (details in the Profile tab)");
+
+    auto share = [&](double partMs) { return executeMs > 0 ? 100.0 * partMs / executeMs : 0.0; };
+
+    // Filling a sorted table re-sorts on every insert
+    profileTable->setSortingEnabled(false);
+    profileTable->setRowCount(0);
+    for (const auto& function : report.functions) {
+        int row = profileTable->rowCount();
+        if (row >= kMaxProfileRows) break;
+        QString name = QString::fromStdString(function.name);
+        double totalMs = ms(function.total);
+        double selfMs = ms(function.self);
+        profileTable->insertRow(row);
+        profileTable->setItem(row, 0, new QTableWidgetItem(function.native ? name + " [native]" : name));
+        profileTable->setItem(row, 1, new QTableWidgetItem(QString::fromStdString(function.location)));
+        profileTable->setItem(row, 2, new NumericTableItem(function.calls, QString::number(function.calls)));
+        profileTable->setItem(row, 3, new NumericTableItem(totalMs, QString::number(totalMs, 'f', 3)));
+        profileTable->setItem(row, 4, new NumericTableItem(selfMs, QString::number(selfMs, 'f', 3)));
+        profileTable->setItem(row, 5, new NumericTableItem(share(selfMs), QString::number(share(selfMs), 'f', 1)));
+    }
+    profileTable->setSortingEnabled(true);
+    profileTable->sortByColumn(4, Qt::DescendingOrder);
+    profileTable->resizeColumnsToContents();
+
+    profileLinesTable->setSortingEnabled(false);
+    profileLinesTable->setRowCount(0);
+    QStringList sourceLines = script.split('\n');
+    for (const auto& line : report.lines) {
+        int row = profileLinesTable->rowCount();
+        if (row >= kMaxProfileRows) break;
+        QString source = (line.line >= 1 && line.line <= sourceLines.size())
+                             ? sourceLines[line.line - 1].trimmed() : QString();
+        double totalMs = ms(line.time);
+        profileLinesTable->insertRow(row);
+        // Sorts by line number, reads like source
+        auto* lineItem = new NumericTableItem(line.line, QString("L%1: %2").arg(line.line).arg(source));
+        lineItem->setTextAlignment(Qt::AlignLeft | Qt::AlignVCenter);
+        profileLinesTable->setItem(row, 0, lineItem);
+        profileLinesTable->setItem(row, 1, new NumericTableItem(line.hits, QString::number(line.hits)));
+        profileLinesTable->setItem(row, 2, new NumericTableItem(totalMs, QString::number(totalMs, 'f', 3)));
+        profileLinesTable->setItem(row, 3, new NumericTableItem(share(totalMs), QString::number(share(totalMs), 'f', 1)));
+    }
+    profileLinesTable->setSortingEnabled(true);
+    profileLinesTable->sortByColumn(2, Qt::DescendingOrder);
+    profileLinesTable->resizeColumnsToContents();
+}
+
+void MainWindow::runPythonTask(const std::function<void()>& task) {
+    auto future = std::async(std::launch::async, task);
+    // User input stays queued so nothing can start a second run meanwhile;
+    // the drain timer keeps firing and shows output as the script prints it
+    while (future.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready) {
+        QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    }
+    flushPythonOutput();
+    future.get();
+}
+
+void MainWindow::flushPythonOutput() {
+    pythonEngine.drainOutput(true);
+    outputSink->flush();
+}
+
 void MainWindow::runCppSineFitting() {
-    auto x_data = plotWidget->getXData();
-    auto y_data = plotWidget->getYData();
+    auto data = plotWidget->dataSet();
+    auto x_data = data.x();
+    auto y_data = data.y();
 
     if (x_data.empty() || y_data.empty()) {
         throw std::runtime_error("No data available for fitting");
@@ -392,8 +602,9 @@ void MainWindow::onCompareFitting() {
         outputTextEdit->append("=== PERFORMANCE COMPARISON: Python vs C++ ===");
         outputTextEdit->append("");
 
-        auto x_data = plotWidget->getXData();
-        auto y_data = plotWidget->getYData();
+        auto data = plotWidget->dataSet();
+        auto x_data = data.x();
+        auto y_data = data.y();
 
         if (x_data.empty() || y_data.empty()) {
             QMessageBox::warning(this, "Warning", "No data available. Generate data first.");
@@ -415,9 +626,8 @@ void MainWindow::onCompareFitting() {
 
         // Run Python fitting (if available)
         std::chrono::microseconds python_time(0);
-        double python_amplitude = 0, python_frequency = 0, python_phase = 0;
+        CppSineFitter::FitResult python_result = {};
         bool python_success = false;
-        std::vector<double> python_fit_x, python_fit_y;
 
         QString currentScript = scriptEditor->toPlainText();
         if (!currentScript.isEmpty()) {
@@ -430,22 +640,19 @@ void MainWindow::onCompareFitting() {
                 }
 
                 auto python_start = std::chrono::high_resolution_clock::now();
-                pythonEngine.setData(x_data, y_data);
-                pythonEngine.executeScript(currentScript.toStdString());
+                std::string script = currentScript.toStdString();
+                runPythonTask([&]() {
+                    pythonEngine.syncData(data);
+                    pythonEngine.executeScript(script);
+                });
                 auto python_end = std::chrono::high_resolution_clock::now();
                 python_time = std::chrono::duration_cast<std::chrono::microseconds>(python_end - python_start);
 
-                python_amplitude = pythonEngine.getScalar("amplitude");
-                python_frequency = pythonEngine.getScalar("frequency");
-                python_phase = pythonEngine.getScalar("phase");
-
-                // Get Python fit data
-                python_fit_x = pythonEngine.getArray("fit_x");
-                python_fit_y = pythonEngine.getArray("fit_y");
-
+                python_result = pythonEngine.getFitResult();
+                flushPythonOutput();
                 python_success = true;
-            } catch (...) {
-                outputTextEdit->append("Python fitting failed or not available");
+            } catch (const std::exception& e) {
+                outputTextEdit->append(QString("Python fitting failed or not available: %1").arg(e.what()));
             }
         }
 
@@ -465,9 +672,10 @@ void MainWindow::onCompareFitting() {
 
         if (python_success) {
             outputTextEdit->append("Python Results:");
-            outputTextEdit->append(QString("  Amplitude: %1").arg(QString::number(python_amplitude, 'f', 4)));
-            outputTextEdit->append(QString("  Frequency: %1").arg(QString::number(python_frequency, 'f', 4)));
-            outputTextEdit->append(QString("  Phase: %1").arg(QString::number(python_phase, 'f', 4)));
+            outputTextEdit->append(QString("  Amplitude: %1").arg(QString::number(python_result.amplitude, 'f', 4)));
+            outputTextEdit->append(QString("  Frequency: %1").arg(QString::number(python_result.frequency, 'f', 4)));
+            outputTextEdit->append(QString("  Phase: %1").arg(QString::number(python_result.phase, 'f', 4)));
+            outputTextEdit->append(QString("  R²: %1").arg(QString::number(python_result.r_squared, 'f', 6)));
             outputTextEdit->append(QString("  Time: %1 μs").arg(python_time.count()));
 
             // Speed comparison
@@ -489,8 +697,8 @@ void MainWindow::onCompareFitting() {
         // Update plot with both results
         plotWidget->setCppFitData(cpp_result.fit_x, cpp_result.fit_y);
 
-        if (python_success && !python_fit_x.empty() && !python_fit_y.empty()) {
-            plotWidget->setPythonFitData(python_fit_x, python_fit_y);
+        if (python_success) {
+            plotWidget->setPythonFitData(python_result.fit_x, python_result.fit_y);
         }
 
         outputTextEdit->append("");
@@ -506,6 +714,152 @@ void MainWindow::onCompareFitting() {
     }
 }
 
+void MainWindow::onRunBenchmark() {
+    auto data = plotWidget->dataSet();
+    auto x_data = data.x();
+    auto y_data = data.y();
+    if (x_data.empty() || y_data.empty()) {
+        QMessageBox::warning(this, "Warning", "No data available. Generate data first.");
+        return;
+    }
+
+    bool ok = false;
+    int repetitions = QInputDialog::getInt(this, "Benchmark", "Timed repetitions per case:", 20, 3, 1000, 1, &ok);
+    if (!ok) return;
+
+    QString currentScript = scriptEditor->toPlainText();
+    std::string script = currentScript.toStdString();
+    bool with_python = !script.empty();
+
+    // Profiling hooks would be timed too, and printing is not what is being
+    // measured; both are restored however the run ends
+    auto previousProfileMode = pythonEngine.profileMode();
+    auto restore = [&]() {
+        pythonEngine.setOutputMuted(false);
+        pythonEngine.setProfileMode(previousProfileMode);
+    };
+
+    try {
+        outputTextEdit->append("=== BENCHMARK: Python vs C++ ===");
+        statusLabel->setText(QString("Benchmarking (%1 repetitions)...").arg(repetitions));
+        QApplication::processEvents();
+
+        if (with_python && !pythonEngine.isInitialized()) {
+            pythonEngine.initialize();
+        }
+        pythonEngine.setProfileMode(PythonEngine::ProfileMode::Off);
+        pythonEngine.setOutputMuted(true);
+
+        BenchmarkHarness harness;
+        harness.addCase("C++", [&](BenchmarkHarness::Sample& sample) {
+            auto fitter = sample.time("marshal", [&]() { return CppSineFitter(x_data, y_data); });
+            sample.time("compute", [&]() { return fitter.fit(300); });
+        });
+        if (with_python) {
+            harness.addCase("Python", [&](BenchmarkHarness::Sample& sample) {
+                pythonEngine.setData(x_data, y_data);
+                pythonEngine.executeScript(script);
+                pythonEngine.getFitResult();
+                const auto& phases = pythonEngine.lastProfile();
+                sample.record("marshal", phases.marshalIn);
+                sample.record("compile", phases.compile);
+                sample.record("compute", phases.execute);
+                sample.record("unmarshal", phases.marshalOut);
+            });
+        }
+
+        BenchmarkHarness::Options options;
+        options.repetitions = static_cast<size_t>(repetitions);
+        BenchmarkHarness::Report report;
+        runPythonTask([&]() { report = harness.run(options); });
+        restore();
+
+        report.metadata["data_points"] = std::to_string(x_data.size());
+#ifdef NDEBUG
+        report.metadata["build_type"] = "release";
+#else
+        report.metadata["build_type"] = "debug";
+#endif
+#ifdef __VERSION__
+        report.metadata["compiler"] = __VERSION__;
+#endif
+        report.metadata["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate).toStdString();
+
+        displayBenchmark(report);
+        lastBenchmark = std::move(report);
+        exportBenchmarkAct->setEnabled(true);
+    } catch (const std::exception& e) {
+        restore();
+        QMessageBox::critical(this, "Benchmark Error",
+                            QString("Error during benchmark: %1").arg(e.what()));
+        statusLabel->setText("Benchmark failed");
+        outputTextEdit->append("ERROR: " + QString(e.what()));
+        outputTextEdit->append("");
+    }
+}
+
+void MainWindow::displayBenchmark(const BenchmarkHarness::Report& report) {
+    auto us = [](double value) { return QString::number(value, 'f', 1); };
+
+    outputTextEdit->append(QString("%1 warm-up + %2 timed runs, %3 points; medians with 95% CI, in μs")
+                         .arg(report.options.warmup)
+                         .arg(report.options.repetitions)
+                         .arg(QString::fromStdString(report.metadata.at("data_points"))));
+    for (const auto& result : report.cases) {
+        outputTextEdit->append("");
+        outputTextEdit->append(QString::fromStdString(result.name) + ":");
+        for (const auto& series : result.series) {
+            const auto& st = series.stats;
+            outputTextEdit->append(QString("  %1 %2 [%3, %4]  p10 %5  p90 %6  sd %7")
+                                 .arg(QString::fromStdString(series.phase), -10)
+                                 .arg(us(st.median), 10)
+                                 .arg(us(st.ci_low))
+                                 .arg(us(st.ci_high))
+                                 .arg(us(st.p10))
+                                 .arg(us(st.p90))
+                                 .arg(us(st.stddev)));
+        }
+    }
+
+    const auto* cpp = report.find("C++");
+    const auto* python = report.find("Python");
+    outputTextEdit->append("");
+    if (cpp && python) {
+        auto speedup = [&](const std::string& phase) {
+            const auto* a = python->find(phase);
+            const auto* b = cpp->find(phase);
+            if (!a || !b) return QString("n/a");
+            auto r = BenchmarkHarness::ratio(a->stats, b->stats);
+            return QString("%1x (%2x - %3x)").arg(QString::number(r.value, 'f', 2),
+                                                  QString::number(r.low, 'f', 2),
+                                                  QString::number(r.high, 'f', 2));
+        };
+        outputTextEdit->append("C++ speedup, total:   " + speedup("total"));
+        outputTextEdit->append("C++ speedup, compute: " + speedup("compute"));
+        statusLabel->setText("Benchmark complete: C++ is " + speedup("total") + " faster");
+    } else {
+        outputTextEdit->append("Python: skipped (script editor is empty)");
+        statusLabel->setText("Benchmark complete (C++ only)");
+    }
+    outputTextEdit->append("Use File > Export Benchmark Results to save the samples.");
+    outputTextEdit->append("");
+}
+
+void MainWindow::onExportBenchmark() {
+    if (!lastBenchmark) return;
+
+    QString fileName = QFileDialog::getSaveFileName(this,
+        "Export Benchmark Results", "benchmark.csv", "CSV (*.csv);;JSON (*.json)");
+    if (fileName.isEmpty()) return;
+
+    try {
+        BenchmarkHarness::save(*lastBenchmark, fileName.toStdString());
+        statusLabel->setText("Benchmark results saved to " + fileName);
+    } catch (const std::exception& e) {
+        QMessageBox::critical(this, "Export Error", e.what());
+    }
+}
+
 void MainWindow::onRegenerateData() {
     plotWidget->generateSineData();
     statusLabel->setText("New sine curve data generated");
@@ -520,17 +874,109 @@ void MainWindow::onClearOutput() {
     outputTextEdit->append("");
 }
 
+void MainWindow::onSessionModeToggled(bool persistent) {
+    size_t releasedBytes = pythonEngine.retainedBytes();
+    pythonEngine.setNamespaceMode(persistent ? PythonEngine::NamespaceMode::Session
+                                             : PythonEngine::NamespaceMode::PerRun);
+
+    outputTextEdit->append(persistent ? "--- Persistent Python session enabled ---"
+                                      : "--- Per-run Python namespaces enabled ---");
+    if (releasedBytes > 0) {
+        outputTextEdit->append(QString("Released previous namespace (%1 MB)")
+                             .arg(QString::number(releasedBytes / (1024.0 * 1024.0), 'f', 2)));
+    }
+    outputTextEdit->append("");
+}
+
 void MainWindow::createActions() {
     loadScriptAct = new QAction(tr("&Load Python Script..."), this);
     loadScriptAct->setShortcut(QKeySequence::Open);
     loadScriptAct->setStatusTip(tr("Load a Python script file"));
     connect(loadScriptAct, &QAction::triggered, this, &MainWindow::onLoadScript);
 
+    exportBenchmarkAct = new QAction(tr("&Export Benchmark Results..."), this);
+    exportBenchmarkAct->setStatusTip(tr("Save the last benchmark's statistics as CSV or JSON"));
+    exportBenchmarkAct->setEnabled(false);
+    connect(exportBenchmarkAct, &QAction::triggered, this, &MainWindow::onExportBenchmark);
+
     exitAct = new QAction(tr("E&xit"), this);
     exitAct->setShortcuts(QKeySequence::Quit);
     exitAct->setStatusTip(tr("Exit the application"));
     connect(exitAct, &QAction::triggered, this, &QWidget::close);
 
+    diagnosticsAct = new QAction(tr("Python &Diagnostics"), this);
+    diagnosticsAct->setStatusTip(tr("Report Python paths and available modules, and refresh the path cache"));
+    connect(diagnosticsAct, &QAction::triggered, this, [this]() {
+        statusLabel->setText("Running Python diagnostics...");
+        QApplication::processEvents();
+        try {
+            pythonEngine.runDiagnostics();
+            flushPythonOutput();
+            statusLabel->setText("Python diagnostics complete");
+        } catch (const std::exception& e) {
+            outputTextEdit->append("ERROR: " + QString(e.what()));
+            statusLabel->setText("Python diagnostics failed");
+        }
+        outputTextEdit->append("");
+    });
+
+    memoryLimitsAct = new QAction(tr("&Memory Limits..."), this);
+    memoryLimitsAct->setStatusTip(tr("Set how much memory an embedded Python run may add before it is reported or cancelled"));
+    connect(memoryLimitsAct, &QAction::triggered, this, [this]() {
+        auto limits = pythonEngine.memoryLimits();
+        bool ok = false;
+        int soft = QInputDialog::getInt(this, "Memory Limits", "Soft limit in MB (report allocation sites, 0 = off):",
+                                        static_cast<int>(limits.softBytes >> 20), 0, 1 << 20, 64, &ok);
+        if (!ok) return;
+        int hard = QInputDialog::getInt(this, "Memory Limits", "Hard limit in MB (cancel the run, 0 = off):",
+                                        static_cast<int>(limits.hardBytes >> 20), 0, 1 << 20, 64, &ok);
+        if (!ok) return;
+        limits.softBytes = static_cast<size_t>(soft) << 20;
+        limits.hardBytes = static_cast<size_t>(hard) << 20;
+        pythonEngine.setMemoryLimits(limits);
+    });
+
+    traceAllocationsAct = new QAction(tr("&Trace Allocations"), this);
+    traceAllocationsAct->setStatusTip(tr("Record Python allocation sites and peak with tracemalloc (slows allocation-heavy scripts)"));
+    traceAllocationsAct->setCheckable(true);
+    connect(traceAllocationsAct, &QAction::toggled, this, [this](bool checked) {
+        auto limits = pythonEngine.memoryLimits();
+        limits.traceAllocations = checked;
+        pythonEngine.setMemoryLimits(limits);
+    });
+
+    asyncRenderAct = new QAction(tr("Render Data in &Background"), this);
+    asyncRenderAct->setStatusTip(tr("Draw the data points on a worker thread so panning and typing never wait for the plot"));
+    asyncRenderAct->setCheckable(true);
+    connect(asyncRenderAct, &QAction::toggled, this, [this](bool checked) {
+        plotWidget->setAsyncRendering(checked);
+        if (checked) gpuScatterAct->setChecked(false);
+    });
+
+    gpuScatterAct = new QAction(tr("Draw Data on the &GPU"), this);
+    gpuScatterAct->setStatusTip(tr("Keep the data points in an OpenGL vertex buffer and draw them in one call"));
+    gpuScatterAct->setCheckable(true);
+    connect(gpuScatterAct, &QAction::toggled, this, [this](bool checked) {
+        plotWidget->setGpuScatter(checked);
+        if (checked) asyncRenderAct->setChecked(false);
+    });
+
+    densityMapAct = new QAction(tr("&Density Map When Crowded"), this);
+    densityMapAct->setStatusTip(tr("Show how many points fall on each pixel once the markers would cover each other"));
+    densityMapAct->setCheckable(true);
+    densityMapAct->setChecked(true);  // the plot's default
+    connect(densityMapAct, &QAction::toggled, this, [this](bool checked) {
+        plotWidget->setDensityMode(checked ? PlotWidgetImpl::DensityMode::Auto : PlotWidgetImpl::DensityMode::Off);
+    });
+
+    frameStatsAct = new QAction(tr("&Frame Statistics"), this);
+    frameStatsAct->setStatusTip(tr("Show how many plot updates were folded into each replot"));
+    connect(frameStatsAct, &QAction::triggered, this, [this]() {
+        auto stats = plotWidget->frameStats();
+        outputTextEdit->append(QString("Plot frames: %1 updates requested, %2 coalesced, %3 rendered, %4 skipped")
+                                   .arg(stats.requested).arg(stats.coalesced).arg(stats.rendered).arg(stats.skipped));
+    });
+
     aboutAct = new QAction(tr("&About"), this);
     aboutAct->setStatusTip(tr("Show the application's About box"));
     connect(aboutAct, &QAction::triggered, this, [this]() {
@@ -546,9 +992,21 @@ void MainWindow::createMenus() {
 
     QMenu* fileMenu = menuBar->addMenu(tr("&File"));
     fileMenu->addAction(loadScriptAct);
+    fileMenu->addAction(exportBenchmarkAct);
     fileMenu->addSeparator();
     fileMenu->addAction(exitAct);
 
+    QMenu* viewMenu = menuBar->addMenu(tr("&View"));
+    viewMenu->addAction(asyncRenderAct);
+    viewMenu->addAction(gpuScatterAct);
+    viewMenu->addAction(densityMapAct);
+    viewMenu->addAction(frameStatsAct);
+
+    QMenu* pythonMenu = menuBar->addMenu(tr("&Python"));
+    pythonMenu->addAction(memoryLimitsAct);
+    pythonMenu->addAction(traceAllocationsAct);
+
     QMenu* helpMenu = menuBar->addMenu(tr("&Help"));
+    helpMenu->addAction(diagnosticsAct);
     helpMenu->addAction(aboutAct);
 }
\ No newline at end of file
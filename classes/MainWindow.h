@@ -4,10 +4,20 @@
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QLabel>
 #include <QtWidgets/QSplitter>
+#include <QtWidgets/QCheckBox>
+#include <QtWidgets/QComboBox>
+#include <QtWidgets/QTableWidget>
+#include <QtWidgets/QTextEdit>
+#include <QtCore/QTimer>
+#include <functional>
+#include <memory>
+#include <optional>
 #include "../classes/PlotWidgetWrapper.h"
 #include "PythonEngine.h"
+#include "QtEngineSink.h"
 #include "PythonHighlighter.h"
 #include "CppSineFitter.h"
+#include "BenchmarkHarness.h"
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -21,6 +31,14 @@ private:
     QPushButton* clearOutputButton;
     QPushButton* runCppAnalysisButton;
     QPushButton* compareFittingButton;
+    QPushButton* benchmarkButton;
+    QCheckBox* sessionCheckBox;
+    QCheckBox* outOfProcessCheckBox;
+    QCheckBox* workerDaemonCheckBox;
+    QComboBox* profileModeCombo;
+    QLabel* profileSummaryLabel;
+    QTableWidget* profileTable;
+    QTableWidget* profileLinesTable;
     QLabel* statusLabel;
     QSplitter* mainSplitter;
     QSplitter* rightSplitter;
@@ -29,12 +47,23 @@ private:
     PythonEngine pythonEngine;
     std::string pythonScript;
     PythonHighlighter* pythonHighlighter;
+    std::shared_ptr<QtEngineSink> outputSink;
+    QTimer* outputDrainTimer;
+    std::optional<BenchmarkHarness::Report> lastBenchmark;
     void createMenus();
     void createActions();
 
     // Menu actions
     QAction* loadScriptAct;
+    QAction* exportBenchmarkAct;
     QAction* exitAct;
+    QAction* diagnosticsAct;
+    QAction* memoryLimitsAct;
+    QAction* traceAllocationsAct;
+    QAction* asyncRenderAct;
+    QAction* gpuScatterAct;
+    QAction* densityMapAct;
+    QAction* frameStatsAct;
     QAction* aboutAct;
 
 public:
@@ -46,11 +75,21 @@ private Q_SLOTS:
     void onRunAnalysis();
     void onRunCppAnalysis();
     void onCompareFitting();
+    void onRunBenchmark();
+    void onExportBenchmark();
     void onRegenerateData();
     void onClearOutput();
+    void onSessionModeToggled(bool persistent);
 
 private:
     void setupUI();
     void runCppSineFitting();
+    // Runs embedded Python work on a worker thread while the GUI keeps
+    // painting and streaming its output; rethrows the task's exception
+    void runPythonTask(const std::function<void()>& task);
+    // Shows all pending engine output now, before appending our own text
+    void flushPythonOutput();
     void displayCppResults(const CppSineFitter::FitResult& result);
+    void displayProfile(const PythonEngine::ProfileReport& report, const QString& script);
+    void displayBenchmark(const BenchmarkHarness::Report& report);
 };
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "MemoryWatchdog.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+MemoryWatchdog::~MemoryWatchdog() {
+    stop();
+}
+
+size_t MemoryWatchdog::residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.WorkingSetSize;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return info.resident_size;
+#else
+    // statm: size and resident, in pages
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+    unsigned long size = 0, resident = 0;
+    int fields = std::fscanf(statm, "%lu %lu", &size, &resident);
+    std::fclose(statm);
+    if (fields != 2) return 0;
+    return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+void MemoryWatchdog::start(const Limits& limits, Callback onSoft, Callback onHard) {
+    stop();
+
+    this->limits = limits;
+    this->onSoft = std::move(onSoft);
+    this->onHard = std::move(onHard);
+    usage = {};
+    usage.start = usage.peak = residentBytes();
+    samplesSinceHard = 0;
+
+    running = true;
+    thread = std::thread([this]() { run(); });
+}
+
+MemoryWatchdog::Usage MemoryWatchdog::stop() {
+    if (!thread.joinable()) return usage;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_one();
+    thread.join();
+
+    usage.end = residentBytes();
+    usage.peak = std::max(usage.peak, usage.end);
+    return usage;
+}
+
+void MemoryWatchdog::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wake.wait_for(lock, limits.interval, [this]() { return !running; })) {
+        // Callbacks may take the GIL; stop() must not wait on that while locked
+        lock.unlock();
+        sample();
+        lock.lock();
+    }
+}
+
+void MemoryWatchdog::sample() {
+    size_t rss = residentBytes();
+    usage.peak = std::max(usage.peak, rss);
+    size_t growth = rss > usage.start ? rss - usage.start : 0;
+
+    if (limits.softBytes > 0 && growth > limits.softBytes && !usage.softExceeded) {
+        usage.softExceeded = true;
+        if (onSoft) onSoft(growth);
+    }
+
+    if (limits.hardBytes > 0 && growth > limits.hardBytes) {
+        if (!usage.hardExceeded || ++samplesSinceHard >= limits.hardRepeat) {
+            usage.hardExceeded = true;
+            samplesSinceHard = 0;
+            if (onHard) onHard(growth);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+// MemoryWatchdog.h - Samples process memory on a background thread during a run
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Tracks the resident set size (RSS) while a run is active and fires a
+// callback when its growth over the start crosses a limit. Callbacks run on
+// the watchdog thread; the soft one fires once per run, the hard one again
+// every `hardRepeat` samples for as long as the growth stays above it (a
+// script may catch the first cancellation).
+class MemoryWatchdog {
+public:
+    struct Limits {
+        size_t softBytes = 0;  // 0 disables
+        size_t hardBytes = 0;
+        std::chrono::milliseconds interval{20};
+        int hardRepeat = 10;
+    };
+
+    // All in bytes; growth figures are relative to `start`
+    struct Usage {
+        size_t start = 0;
+        size_t peak = 0;
+        size_t end = 0;
+        bool softExceeded = false;
+        bool hardExceeded = false;
+    };
+
+    using Callback = std::function<void(size_t growth)>;
+
+    MemoryWatchdog() = default;
+    ~MemoryWatchdog();
+
+    MemoryWatchdog(const MemoryWatchdog&) = delete;
+    MemoryWatchdog& operator=(const MemoryWatchdog&) = delete;
+
+    void start(const Limits& limits, Callback onSoft, Callback onHard);
+    // Joins the sampling thread, so callbacks must not wait on the caller
+    Usage stop();
+
+    // Current RSS of this process, 0 where it cannot be read
+    static size_t residentBytes();
+
+private:
+    void run();
+    void sample();
+
+    Limits limits;
+    Callback onSoft;
+    Callback onHard;
+    Usage usage;
+    int samplesSinceHard = 0;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool running = false;
+};
@@ -0,0 +1,138 @@
+#include "MinMaxPyramid.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+bool isAscending(std::span<const double> x, size_t from) {
+    for (size_t i = std::max<size_t>(from, 1); i < x.size(); ++i) {
+        if (x[i] < x[i - 1]) return false;
+    }
+    return true;
+}
+
+}
+
+void MinMaxPyramid::clear() {
+    levels.clear();
+    count = 0;
+    ascending = true;
+}
+
+void MinMaxPyramid::build(std::span<const double> x, std::span<const double> y) {
+    clear();
+    append(x, y);
+}
+
+void MinMaxPyramid::append(std::span<const double> x, std::span<const double> y) {
+    if (x.size() != y.size()) {
+        throw std::invalid_argument("X and Y data vectors must have the same size");
+    }
+    if (x.size() < count) {
+        throw std::invalid_argument("Appended trace is shorter than the summarized one");
+    }
+    if (x.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Trace too long for MinMaxPyramid");
+    }
+    if (x.size() == count) return;
+
+    ascending = ascending && isAscending(x, count);
+    size_t from = count / kFanout;  // the last, possibly partial, bucket changes too
+    count = x.size();
+    rebuildFrom(y, from);
+}
+
+void MinMaxPyramid::rebuildFrom(std::span<const double> y, size_t from) {
+    size_t childCount = count;
+    for (size_t level = 0; childCount > 1; ++level) {
+        size_t nodes = (childCount + kFanout - 1) / kFanout;
+        if (levels.size() <= level) levels.emplace_back();
+        auto& current = levels[level];
+        current.resize(nodes);
+
+        for (size_t node = from; node < nodes; ++node) {
+            size_t begin = node * kFanout;
+            size_t end = std::min(begin + kFanout, childCount);
+            Node summary;
+            if (level == 0) {
+                summary = {static_cast<uint32_t>(begin), static_cast<uint32_t>(begin)};
+                for (size_t i = begin + 1; i < end; ++i) {
+                    if (y[i] < y[summary.min]) summary.min = static_cast<uint32_t>(i);
+                    if (y[i] > y[summary.max]) summary.max = static_cast<uint32_t>(i);
+                }
+            } else {
+                const auto& children = levels[level - 1];
+                summary = children[begin];
+                for (size_t i = begin + 1; i < end; ++i) {
+                    if (y[children[i].min] < y[summary.min]) summary.min = children[i].min;
+                    if (y[children[i].max] > y[summary.max]) summary.max = children[i].max;
+                }
+            }
+            current[node] = summary;
+        }
+
+        childCount = nodes;
+        from /= kFanout;
+    }
+}
+
+void MinMaxPyramid::summarize(std::span<const double> y, size_t begin, size_t end, size_t& min, size_t& max) const {
+    min = max = begin;
+    size_t i = begin;
+    while (i < end) {
+        // Climb to the coarsest node that starts at i and ends inside the range
+        size_t span = 1;
+        size_t level = 0;
+        while (level < levels.size() && i % (span * kFanout) == 0 && i + span * kFanout <= end) {
+            span *= kFanout;
+            ++level;
+        }
+
+        size_t nodeMin = i, nodeMax = i;
+        if (level > 0) {
+            const Node& node = levels[level - 1][i / span];
+            nodeMin = node.min;
+            nodeMax = node.max;
+        }
+        if (y[nodeMin] < y[min]) min = nodeMin;
+        if (y[nodeMax] > y[max]) max = nodeMax;
+        i += span;
+    }
+}
+
+std::vector<size_t> MinMaxPyramid::visibleIndices(std::span<const double> x, std::span<const double> y,
+                                                  double xMin, double xMax, size_t columns) const {
+    std::vector<size_t> indices;
+    if (count == 0 || x.size() < count || !ascending || !(xMax > xMin)) return indices;
+    columns = std::max<size_t>(columns, 1);
+    x = x.first(count);
+
+    size_t first = std::lower_bound(x.begin(), x.end(), xMin) - x.begin();
+    size_t last = std::upper_bound(x.begin(), x.end(), xMax) - x.begin();
+
+    if (first > 0) indices.push_back(first - 1);
+    if (last - first <= 4 * columns) {
+        for (size_t i = first; i < last; ++i) indices.push_back(i);
+    } else {
+        indices.reserve(2 * columns + 2);
+        double width = (xMax - xMin) / static_cast<double>(columns);
+        size_t begin = first;
+        for (size_t column = 1; column <= columns && begin < last; ++column) {
+            size_t end = last;
+            if (column < columns) {
+                double edge = xMin + width * static_cast<double>(column);
+                end = std::lower_bound(x.begin() + begin, x.begin() + last, edge) - x.begin();
+            }
+            if (end == begin) continue;
+
+            size_t min, max;
+            summarize(y, begin, end, min, max);
+            indices.push_back(std::min(min, max));
+            if (min != max) indices.push_back(std::max(min, max));
+            begin = end;
+        }
+    }
+    if (last < count) indices.push_back(last);
+    return indices;
+}
@@ -0,0 +1,50 @@
+// MinMaxPyramid.h - Multi-resolution min/max summary of a trace for drawing
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Level k (k >= 1) holds one node per kFanout^k samples with the indices of
+// the bucket's smallest and largest y; its first and last samples are the
+// bucket bounds. A query splits the visible x range into pixel columns and
+// summarizes each from the coarsest nodes that fit, so drawing costs
+// O(columns * log N) however many samples are visible. Built once per
+// dataset, and on append only the tail buckets are recomputed.
+//
+// The arrays are not stored: every call takes the trace it was built from.
+// Queries need x sorted ascending; sorted() reports whether it was.
+class MinMaxPyramid {
+public:
+    static constexpr size_t kFanout = 8;
+
+    void build(std::span<const double> x, std::span<const double> y);
+    // x/y are the whole trace after the append; the first size() samples
+    // must be the ones the pyramid was built from
+    void append(std::span<const double> x, std::span<const double> y);
+    void clear();
+
+    size_t size() const { return count; }
+    bool sorted() const { return ascending; }
+
+    // Sample indices to draw [xMin, xMax] on `columns` pixels, ascending:
+    // the minimum and maximum of every column, plus the nearest sample past
+    // each edge so lines reach the border. With few enough visible samples
+    // (up to 4 per column) all of them are returned.
+    std::vector<size_t> visibleIndices(std::span<const double> x, std::span<const double> y,
+                                       double xMin, double xMax, size_t columns) const;
+
+private:
+    struct Node {
+        uint32_t min;
+        uint32_t max;
+    };
+
+    // Recomputes levels[*] from bucket `from` of level 1 onward
+    void rebuildFrom(std::span<const double> y, size_t from);
+    void summarize(std::span<const double> y, size_t begin, size_t end, size_t& min, size_t& max) const;
+
+    std::vector<std::vector<Node>> levels;  // levels[0] is level 1
+    size_t count = 0;
+    bool ascending = true;
+};
@@ -0,0 +1,282 @@
+#include "ModelFitter.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+// Upper bound on values produced per model batch (32 MB of doubles); larger
+// populations are split into several calls
+constexpr size_t kMaxBatchValues = size_t(1) << 22;
+
+// Solves A x = b in place (A is k x k row-major) with partial pivoting
+bool solveLinear(std::vector<double>& A, std::vector<double>& b, size_t k) {
+    for (size_t col = 0; col < k; ++col) {
+        size_t pivot = col;
+        for (size_t row = col + 1; row < k; ++row) {
+            if (std::abs(A[row * k + col]) > std::abs(A[pivot * k + col])) pivot = row;
+        }
+        if (std::abs(A[pivot * k + col]) < 1e-300) return false;
+        if (pivot != col) {
+            for (size_t j = 0; j < k; ++j) std::swap(A[col * k + j], A[pivot * k + j]);
+            std::swap(b[col], b[pivot]);
+        }
+        for (size_t row = col + 1; row < k; ++row) {
+            double factor = A[row * k + col] / A[col * k + col];
+            for (size_t j = col; j < k; ++j) A[row * k + j] -= factor * A[col * k + j];
+            b[row] -= factor * b[col];
+        }
+    }
+    for (size_t i = k; i-- > 0;) {
+        double sum = b[i];
+        for (size_t j = i + 1; j < k; ++j) sum -= A[i * k + j] * b[j];
+        b[i] = sum / A[i * k + i];
+    }
+    return true;
+}
+
+}
+
+ModelFitter::ModelFitter(std::span<const double> x, std::span<const double> y, size_t paramCount,
+                         BatchModel model, JacobianModel jacobian)
+    : x(x), y(y), k(paramCount), model(std::move(model)), jacobian(std::move(jacobian)) {
+    if (x.empty() || x.size() != y.size()) {
+        throw std::invalid_argument("x and y must be non-empty and of the same length");
+    }
+    if (k == 0) {
+        throw std::invalid_argument("Model needs at least one parameter");
+    }
+    if (!this->model) {
+        throw std::invalid_argument("Model function is required");
+    }
+}
+
+void ModelFitter::evaluate(std::span<const double> params, size_t count, std::span<double> out) {
+    size_t n = x.size();
+    size_t perCall = std::max<size_t>(1, kMaxBatchValues / n);
+    for (size_t first = 0; first < count; first += perCall) {
+        size_t chunk = std::min(perCall, count - first);
+        model(params.subspan(first * k, chunk * k), chunk, out.subspan(first * n, chunk * n));
+        ++modelCalls;
+    }
+    evaluations += count;
+}
+
+double ModelFitter::sse(std::span<const double> prediction) const {
+    double sum = 0.0;
+    for (size_t i = 0; i < y.size(); ++i) {
+        double residual = y[i] - prediction[i];
+        sum += residual * residual;
+    }
+    // NaN/inf from the model must never win a comparison
+    return std::isfinite(sum) ? sum : std::numeric_limits<double>::max();
+}
+
+void ModelFitter::jacobianAt(std::span<const double> params, std::span<const double> prediction,
+                             std::vector<double>& J) {
+    size_t n = x.size();
+    J.resize(n * k);
+    if (jacobian) {
+        jacobian(params, J);
+        return;
+    }
+
+    // Forward differences: all k perturbed parameter sets in one batch
+    std::vector<double> shifted(k * k);
+    std::vector<double> steps(k);
+    for (size_t j = 0; j < k; ++j) {
+        std::copy(params.begin(), params.end(), shifted.begin() + j * k);
+        steps[j] = 1.4901161193847656e-8 * std::max(1.0, std::abs(params[j]));
+        shifted[j * k + j] += steps[j];
+    }
+    std::vector<double> values(k * n);
+    evaluate(shifted, k, values);
+
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < k; ++j) {
+            J[i * k + j] = (values[j * n + i] - prediction[i]) / steps[j];
+        }
+    }
+}
+
+ModelFitter::Result ModelFitter::levenbergMarquardt(std::vector<double> initial, int maxIter, double lambdaInit) {
+    auto start = std::chrono::steady_clock::now();
+    if (initial.size() != k) {
+        throw std::invalid_argument("Initial parameters do not match the parameter count");
+    }
+
+    size_t n = x.size();
+    std::vector<double> params = std::move(initial);
+    std::vector<double> prediction(n);
+    evaluate(params, 1, prediction);
+    double cost = sse(prediction);
+
+    double lambda = lambdaInit;
+    std::vector<double> J, JtJ(k * k), Jtr(k), A, delta, trial(k), trialPrediction(n);
+    bool jacobianStale = true;
+
+    for (int iteration = 0; iteration < maxIter; ++iteration) {
+        // Rejected steps reuse the Jacobian: the parameters did not move
+        if (jacobianStale) {
+            jacobianAt(params, prediction, J);
+            std::fill(JtJ.begin(), JtJ.end(), 0.0);
+            std::fill(Jtr.begin(), Jtr.end(), 0.0);
+            for (size_t i = 0; i < n; ++i) {
+                const double* row = &J[i * k];
+                double residual = y[i] - prediction[i];
+                for (size_t a = 0; a < k; ++a) {
+                    for (size_t b = 0; b < k; ++b) {
+                        JtJ[a * k + b] += row[a] * row[b];
+                    }
+                    Jtr[a] += row[a] * residual;
+                }
+            }
+            jacobianStale = false;
+        }
+
+        A = JtJ;
+        delta = Jtr;
+        for (size_t a = 0; a < k; ++a) {
+            A[a * k + a] += lambda * std::max(JtJ[a * k + a], 1e-12);
+        }
+        if (!solveLinear(A, delta, k)) {
+            lambda *= 10.0;
+            continue;
+        }
+
+        for (size_t a = 0; a < k; ++a) trial[a] = params[a] + delta[a];
+        evaluate(trial, 1, trialPrediction);
+        double trialCost = sse(trialPrediction);
+
+        if (trialCost < cost) {
+            params.swap(trial);
+            prediction.swap(trialPrediction);
+            cost = trialCost;
+            lambda *= 0.1;
+            jacobianStale = true;
+
+            double norm = 0.0;
+            for (double d : delta) norm += d * d;
+            if (std::sqrt(norm) < 1e-8) break;
+        } else {
+            lambda *= 10.0;
+            if (lambda > 1e16) break;
+        }
+    }
+
+    return finish(std::move(params), start);
+}
+
+ModelFitter::Result ModelFitter::differentialEvolution(const std::vector<std::pair<double, double>>& bounds,
+                                                       int maxIter, size_t popSize, double F, double CR,
+                                                       unsigned seed) {
+    auto start = std::chrono::steady_clock::now();
+    if (bounds.size() != k) {
+        throw std::invalid_argument("Bounds do not match the parameter count");
+    }
+    popSize = std::max<size_t>(popSize, 4);
+
+    size_t n = x.size();
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    std::uniform_int_distribution<size_t> pick(0, popSize - 1);
+    std::uniform_int_distribution<size_t> pickParam(0, k - 1);
+
+    std::vector<double> population(popSize * k);
+    for (size_t i = 0; i < popSize; ++i) {
+        for (size_t j = 0; j < k; ++j) {
+            population[i * k + j] = bounds[j].first + dis(gen) * (bounds[j].second - bounds[j].first);
+        }
+    }
+
+    std::vector<double> predictions(popSize * n);
+    std::vector<double> fitness(popSize);
+    evaluate(population, popSize, predictions);
+    for (size_t i = 0; i < popSize; ++i) {
+        fitness[i] = sse(std::span<const double>(predictions).subspan(i * n, n));
+    }
+
+    std::vector<double> trials(popSize * k);
+    for (int generation = 0; generation < maxIter; ++generation) {
+        // Trials are built from the previous generation, then scored together
+        for (size_t i = 0; i < popSize; ++i) {
+            size_t a, b, c;
+            do { a = pick(gen); } while (a == i);
+            do { b = pick(gen); } while (b == i || b == a);
+            do { c = pick(gen); } while (c == i || c == a || c == b);
+
+            size_t forced = pickParam(gen);
+            for (size_t j = 0; j < k; ++j) {
+                double value = population[i * k + j];
+                if (j == forced || dis(gen) < CR) {
+                    value = population[a * k + j] + F * (population[b * k + j] - population[c * k + j]);
+                    value = std::clamp(value, bounds[j].first, bounds[j].second);
+                }
+                trials[i * k + j] = value;
+            }
+        }
+
+        evaluate(trials, popSize, predictions);
+        for (size_t i = 0; i < popSize; ++i) {
+            double trialFitness = sse(std::span<const double>(predictions).subspan(i * n, n));
+            if (trialFitness < fitness[i]) {
+                std::copy_n(trials.begin() + i * k, k, population.begin() + i * k);
+                fitness[i] = trialFitness;
+            }
+        }
+    }
+
+    size_t best = std::min_element(fitness.begin(), fitness.end()) - fitness.begin();
+    std::vector<double> params(population.begin() + best * k, population.begin() + (best + 1) * k);
+    return finish(std::move(params), start);
+}
+
+ModelFitter::Result ModelFitter::finish(std::vector<double> params, std::chrono::steady_clock::time_point start) {
+    size_t n = x.size();
+    Result result;
+
+    std::vector<double> prediction(n);
+    evaluate(params, 1, prediction);
+    result.sse = sse(prediction);
+
+    double mean = 0.0;
+    for (double value : y) mean += value;
+    mean /= static_cast<double>(n);
+    double ssTot = 0.0;
+    for (double value : y) ssTot += (value - mean) * (value - mean);
+    result.r_squared = (ssTot > 0) ? 1.0 - result.sse / ssTot : 0.0;
+    result.rmse = std::sqrt(result.sse / static_cast<double>(n));
+
+    // Standard errors from the diagonal of (JtJ)^-1 * sse / (n - k)
+    result.param_errors.assign(k, 0.0);
+    if (n > k) {
+        std::vector<double> J;
+        jacobianAt(params, prediction, J);
+        std::vector<double> JtJ(k * k, 0.0);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t a = 0; a < k; ++a) {
+                for (size_t b = 0; b < k; ++b) {
+                    JtJ[a * k + b] += J[i * k + a] * J[i * k + b];
+                }
+            }
+        }
+        double variance = result.sse / static_cast<double>(n - k);
+        for (size_t j = 0; j < k; ++j) {
+            std::vector<double> A = JtJ;
+            std::vector<double> column(k, 0.0);
+            column[j] = 1.0;
+            if (solveLinear(A, column, k)) {
+                result.param_errors[j] = std::sqrt(std::abs(column[j] * variance));
+            }
+        }
+    }
+
+    result.params = std::move(params);
+    result.evaluations = evaluations;
+    result.model_calls = modelCalls;
+    result.fit_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return result;
+}
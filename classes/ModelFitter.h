@@ -0,0 +1,61 @@
+// ModelFitter.h - Levenberg-Marquardt and differential evolution for arbitrary models
+#pragma once
+#include <chrono>
+#include <functional>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Fits y ~ model(x; p) for any number of parameters. The model is always
+// evaluated in batches of parameter sets, so an expensive-to-enter model (a
+// Python function, say) is called once per finite-difference Jacobian, LM
+// trial step or DE generation rather than once per sample or candidate.
+class ModelFitter {
+public:
+    // Writes the model at `count` parameter sets (row-major in `params`,
+    // count x paramCount) into `out`, count x n row-major
+    using BatchModel = std::function<void(std::span<const double> params, size_t count, std::span<double> out)>;
+    // Writes d model / d p at one parameter set into `out`, n x paramCount row-major
+    using JacobianModel = std::function<void(std::span<const double> params, std::span<double> out)>;
+
+    struct Result {
+        std::vector<double> params;
+        std::vector<double> param_errors;
+        double sse = 0.0;
+        double r_squared = 0.0;
+        double rmse = 0.0;
+        size_t evaluations = 0;  // parameter sets evaluated since construction
+        size_t model_calls = 0;  // batches handed to the model since construction
+        std::chrono::microseconds fit_time{0};
+    };
+
+    ModelFitter(std::span<const double> x, std::span<const double> y, size_t paramCount,
+                BatchModel model, JacobianModel jacobian = {});
+
+    size_t size() const { return x.size(); }
+    size_t paramCount() const { return k; }
+
+    // Local refinement from `initial`. Without an analytical Jacobian the
+    // forward differences for all parameters go to the model as one batch.
+    Result levenbergMarquardt(std::vector<double> initial, int maxIter = 100, double lambdaInit = 1e-3);
+
+    // Global DE/rand/1/bin search inside `bounds`; each generation's trial
+    // population is evaluated as one batch
+    Result differentialEvolution(const std::vector<std::pair<double, double>>& bounds, int maxIter = 200,
+                                 size_t popSize = 40, double F = 0.8, double CR = 0.9, unsigned seed = 42);
+
+private:
+    void evaluate(std::span<const double> params, size_t count, std::span<double> out);
+    double sse(std::span<const double> prediction) const;
+    void jacobianAt(std::span<const double> params, std::span<const double> prediction, std::vector<double>& J);
+    Result finish(std::vector<double> params, std::chrono::steady_clock::time_point start);
+
+    std::span<const double> x;
+    std::span<const double> y;
+    size_t k;
+    BatchModel model;
+    JacobianModel jacobian;
+
+    size_t evaluations = 0;
+    size_t modelCalls = 0;
+};
@@ -0,0 +1,101 @@
+#include "OutputRingBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+}
+
+OutputRingBuffer::OutputRingBuffer(size_t capacity)
+    : buffer(roundUpToPowerOfTwo(std::max<size_t>(capacity, 64)))
+    , mask(buffer.size() - 1) {
+}
+
+size_t OutputRingBuffer::size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+}
+
+size_t OutputRingBuffer::freeSpace() const {
+    return buffer.size() - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+}
+
+void OutputRingBuffer::copyIn(const char* data, size_t size) {
+    size_t start = head.load(std::memory_order_relaxed);
+    size_t offset = start & mask;
+    size_t first = std::min(size, buffer.size() - offset);
+    std::memcpy(buffer.data() + offset, data, first);
+    std::memcpy(buffer.data(), data + first, size - first);
+    head.store(start + size, std::memory_order_release);
+}
+
+void OutputRingBuffer::write(const char* data, size_t size) {
+    if (size == 0 || muted.load(std::memory_order_relaxed)) return;
+
+    if (policy.load(std::memory_order_relaxed) == Backpressure::Block) {
+        // Stream in capacity-sized pieces, waiting for the consumer between them
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(blockTimeoutMs.load(std::memory_order_relaxed));
+        while (size > 0) {
+            size_t chunk = std::min(size, freeSpace());
+            if (chunk > 0) {
+                copyIn(data, chunk);
+                data += chunk;
+                size -= chunk;
+                continue;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                // Nobody is draining; fall back to dropping rather than hang the script
+                dropped.fetch_add(size, std::memory_order_relaxed);
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        return;
+    }
+
+    // Keep writes whole so lines are never torn
+    if (size > freeSpace()) {
+        dropped.fetch_add(size, std::memory_order_relaxed);
+        return;
+    }
+    copyIn(data, size);
+}
+
+size_t OutputRingBuffer::read(std::string& out, size_t maxBytes) {
+    size_t start = tail.load(std::memory_order_relaxed);
+    size_t available = head.load(std::memory_order_acquire) - start;
+    size_t count = std::min(available, maxBytes);
+    if (count == 0) return 0;
+
+    size_t offset = start & mask;
+    size_t first = std::min(count, buffer.size() - offset);
+    out.append(buffer.data() + offset, first);
+    out.append(buffer.data(), count - first);
+    tail.store(start + count, std::memory_order_release);
+    return count;
+}
+
+size_t OutputRingBuffer::takeDroppedBytes() {
+    return dropped.exchange(0, std::memory_order_relaxed);
+}
+
+void OutputRingBuffer::setMuted(bool mute) {
+    muted.store(mute, std::memory_order_relaxed);
+}
+
+void OutputRingBuffer::setBackpressure(Backpressure newPolicy) {
+    policy.store(newPolicy, std::memory_order_relaxed);
+}
+
+void OutputRingBuffer::setBlockTimeout(std::chrono::milliseconds timeout) {
+    blockTimeoutMs.store(timeout.count(), std::memory_order_relaxed);
+}
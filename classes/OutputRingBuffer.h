@@ -0,0 +1,51 @@
+// OutputRingBuffer.h - Lock-free byte ring for streaming Python stdout/stderr
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Single-producer / single-consumer ring. The producer is whichever thread
+// holds the GIL (Python writes are serialized by it), the consumer is the
+// engine's drain, which serializes its callers. Memory is bounded by the capacity chosen at construction.
+class OutputRingBuffer {
+public:
+    enum class Backpressure {
+        DropNewest,  // writes that do not fit are discarded and counted
+        Block        // the writer waits for the consumer (up to blockTimeout)
+    };
+
+    // Capacity is rounded up to a power of two
+    explicit OutputRingBuffer(size_t capacity = size_t(1) << 20);
+
+    // Producer side
+    void write(const char* data, size_t size);
+    void write(const std::string& text) { write(text.data(), text.size()); }
+
+    // Consumer side: appends at most maxBytes to `out`, returns the count
+    size_t read(std::string& out, size_t maxBytes);
+    // Bytes discarded since the last call
+    size_t takeDroppedBytes();
+
+    // While muted every write is discarded without being counted as dropped
+    void setMuted(bool muted);
+    void setBackpressure(Backpressure policy);
+    void setBlockTimeout(std::chrono::milliseconds timeout);
+    size_t capacity() const { return buffer.size(); }
+    size_t size() const;
+
+private:
+    size_t freeSpace() const;
+    void copyIn(const char* data, size_t size);
+
+    std::vector<char> buffer;
+    size_t mask;
+
+    alignas(64) std::atomic<size_t> head{0};  // written by the producer
+    alignas(64) std::atomic<size_t> tail{0};  // written by the consumer
+    alignas(64) std::atomic<size_t> dropped{0};
+    std::atomic<Backpressure> policy{Backpressure::DropNewest};
+    std::atomic<bool> muted{false};
+    std::atomic<long long> blockTimeoutMs{2000};
+};
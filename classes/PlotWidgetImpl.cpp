@@ -1,6 +1,12 @@
 // PlotWidgetImpl.cpp - Qt/QCustomPlot implementation
 #include "PlotWidgetImpl.h"
+#include "SineDataGenerator.h"
+#include "GraphDataFill.h"
+#include "TraceFrameItem.h"
+#include "GlScatterPlottable.h"
+#include <algorithm>
 #include <cmath>
+#include <stdexcept>
 #include <QApplication>
 
 PlotWidgetImpl::PlotWidgetImpl(QWidget* parent)
@@ -59,12 +65,9 @@ void PlotWidgetImpl::setupUI() {
 
 void PlotWidgetImpl::resizeEvent(QResizeEvent* event) {
     QWidget::resizeEvent(event);
-    if (customPlot) {
-        // Force a replot after resize to fix OpenGL viewport issues
-        QTimer::singleShot(10, [this]() {
-            customPlot->replot();
-        });
-    }
+    // A live resize sends a stream of these; they share one replot per
+    // frame, which also fixes up the OpenGL viewport
+    if (frames) refresh();
 }
 
 
@@ -122,6 +125,29 @@ void PlotWidgetImpl::setupPlot() {
     QObject::connect(customPlot->yAxis, QOverload<const QCPRange &>::of(&QCPAxis::rangeChanged),
                      customPlot->yAxis2, QOverload<const QCPRange &>::of(&QCPAxis::setRange));
 
+    // Pan and zoom re-query the level-of-detail pyramid for large traces
+    QObject::connect(customPlot->xAxis, QOverload<const QCPRange &>::of(&QCPAxis::rangeChanged),
+                     this, [this]() {
+        densityStale = true;
+        if (useLod() && dataOnGraph() && !densityShown) updateVisibleData();
+    });
+    QObject::connect(customPlot->yAxis, QOverload<const QCPRange &>::of(&QCPAxis::rangeChanged),
+                     this, [this]() { densityStale = true; });
+    // A drag moves both axes; the density map is rebinned once for the two
+    QObject::connect(customPlot, &QCustomPlot::beforeReplot, this, [this]() {
+        if (densityStale) updateDensity();
+    });
+
+    // Pans, zooms and resizes all end in a replot, which has settled the
+    // layout; one frame request covers each
+    QObject::connect(customPlot, &QCustomPlot::afterReplot, this, [this]() {
+        if (!dataOnFrames() || densityShown) return;
+        if (customPlot->xAxis->range() != requestedXRange || customPlot->yAxis->range() != requestedYRange ||
+            customPlot->axisRect()->rect() != requestedRect) {
+            requestTraceFrame();
+        }
+    });
+
     // Set axis labels
     customPlot->xAxis->setLabel("X");
     customPlot->yAxis->setLabel("Y");
@@ -161,6 +187,32 @@ void PlotWidgetImpl::setupPlot() {
     pythonFitGraph->setPen(pythonPen);
     pythonFitGraph->setName("Python Fit");
 
+    // The data on "main" and the fit curves on a layer above it each get a
+    // paint buffer, so a new fit redraws the curves and not every data point
+    dataLayer = customPlot->layer("main");
+    dataLayer->setMode(QCPLayer::lmBuffered);
+    customPlot->addLayer("fits", dataLayer, QCustomPlot::limAbove);
+    fitLayer = customPlot->layer("fits");
+    fitLayer->setMode(QCPLayer::lmBuffered);
+    fitGraph->setLayer(fitLayer);
+    cppFitGraph->setLayer(fitLayer);
+    pythonFitGraph->setLayer(fitLayer);
+    layers = std::make_unique<LayerDirtyTracker>(customPlot);
+    frames = std::make_unique<FrameScheduler>(customPlot, layers.get(), [this]() {
+        // The rect size decides the density map's cells and how crowded
+        // the markers are
+        bool resized = customPlot->axisRect()->rect().size() != densitySize;
+        if ((densityStale || (resized && densityPolicy != DensityMode::Off)) && updateDensity()) {
+            layers->invalidate(dataLayer);
+        }
+        // The pixel width decides how many points the graph gets
+        if (useLod() && dataOnGraph() && !densityShown &&
+            static_cast<size_t>(customPlot->axisRect()->width()) != lodColumns) {
+            updateVisibleData();
+            layers->invalidate(dataLayer);
+        }
+    });
+
     // Enable interactions
     customPlot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom | QCP::iSelectPlottables);
     customPlot->axisRect()->setRangeDrag(Qt::Horizontal | Qt::Vertical);
@@ -172,142 +224,341 @@ void PlotWidgetImpl::setupPlot() {
 }
 
 void PlotWidgetImpl::setCppFitData(const std::vector<double>& fit_x, const std::vector<double>& fit_y) {
-    QVector<double> x_vec, y_vec;
-
-    for (size_t i = 0; i < fit_x.size(); ++i) {
-        x_vec.append(fit_x[i]);
-        y_vec.append(fit_y[i]);
-    }
+    setCppFitData(GraphDataFill::fromSpans(fit_x, fit_y));
+}
 
-    cppFitGraph->setData(x_vec, y_vec);
-    customPlot->replot();
+void PlotWidgetImpl::setCppFitData(QSharedPointer<QCPGraphDataContainer> data) {
+    cppFitGraph->setData(std::move(data));
+    refresh(fitLayer);
 }
 
 void PlotWidgetImpl::setPythonFitData(const std::vector<double>& fit_x, const std::vector<double>& fit_y) {
-    QVector<double> x_vec, y_vec;
-
-    for (size_t i = 0; i < fit_x.size(); ++i) {
-        x_vec.append(fit_x[i]);
-        y_vec.append(fit_y[i]);
-    }
+    setPythonFitData(GraphDataFill::fromSpans(fit_x, fit_y));
+}
 
-    pythonFitGraph->setData(x_vec, y_vec);
-    customPlot->replot();
+void PlotWidgetImpl::setPythonFitData(QSharedPointer<QCPGraphDataContainer> data) {
+    pythonFitGraph->setData(std::move(data));
+    refresh(fitLayer);
 }
 
 void PlotWidgetImpl::clearFitData() {
     cppFitGraph->data()->clear();
     pythonFitGraph->data()->clear();
     fitGraph->data()->clear();
-    customPlot->replot();
+    refresh(fitLayer);
 }
 
 
 void PlotWidgetImpl::generateSineData() {
-    x_data.clear();
-    y_data.clear();
-
-    QVector<double> x_vec, y_vec;
-
-    const int numPoints = 100;
-
-    // More reasonable random distributions
-    std::uniform_real_distribution<double> amplitude_dist(0.8, 2.2);     // Moderate amplitude changes
-    std::uniform_real_distribution<double> frequency_dist(0.8, 2.5);     // Reasonable frequency variations
-    std::uniform_real_distribution<double> phase_dist(0.0, 2.0 * M_PI);  // Random phase shifts
-    std::uniform_real_distribution<double> noise_dist(-0.8, 0.8);        // Stronger but reasonable noise
-    std::uniform_real_distribution<double> offset_dist(-1.0, 1.0);       // Moderate DC offset
-
-    // Generate fewer segments with smoother transitions
-    const int segments = 3;  // Fewer segments for more coherent sine waves
-    const int pointsPerSegment = numPoints / segments;
-
-    // Initialize with base parameters
-    double prev_amplitude = amplitude_dist(rng);
-    double prev_frequency = frequency_dist(rng);
-    double prev_phase = phase_dist(rng);
-    double prev_offset = offset_dist(rng);
-
-    for (int seg = 0; seg < segments; ++seg) {
-        // Gradually change parameters for smoother transitions
-        double amplitude = prev_amplitude + std::uniform_real_distribution<double>(-0.5, 0.5)(rng);
-        double frequency = prev_frequency + std::uniform_real_distribution<double>(-0.3, 0.3)(rng);
-        double phase = prev_phase + std::uniform_real_distribution<double>(-M_PI/2, M_PI/2)(rng);
-        double offset = prev_offset + std::uniform_real_distribution<double>(-0.5, 0.5)(rng);
-
-        // Keep parameters within reasonable bounds
-        amplitude = std::max(0.5, std::min(3.0, amplitude));
-        frequency = std::max(0.5, std::min(3.0, frequency));
-        offset = std::max(-2.0, std::min(2.0, offset));
-
-        int startIdx = seg * pointsPerSegment;
-        int endIdx = (seg == segments - 1) ? numPoints : (seg + 1) * pointsPerSegment;
-
-        for (int i = startIdx; i < endIdx; ++i) {
-            // Smooth x progression with minimal randomness
-            double x_base = (2.0 * M_PI * i / (numPoints - 1));
-            double x_noise = noise_dist(rng) * 0.05;  // Very small x-axis noise
-            double x = x_base + x_noise;
-
-            // Main sine wave with current parameters
-            double y_base = amplitude * sin(frequency * x + phase) + offset;
-
-            // Add reasonable noise
-            double y_noise = noise_dist(rng) * 0.3;  // Moderate noise level
-
-            // Occasional small spikes (much less frequent and smaller)
-            if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < 0.05) {
-                y_noise += std::uniform_real_distribution<double>(-1.5, 1.5)(rng);
-            }
-
-            double y = y_base + y_noise;
-
-            x_data.push_back(x);
-            y_data.push_back(y);
-            x_vec.append(x);
-            y_vec.append(y);
+    auto generated = SineDataGenerator::generate(rng);
+    trace = DataSet(std::move(generated.x), std::move(generated.y));
+    dataLod.build(trace.x(), trace.y());
+
+    updateAxisRanges();
+    showData();
+    densityStale = true;
+    refresh();
+}
+
+void PlotWidgetImpl::appendData(const std::vector<double>& x, const std::vector<double>& y) {
+    if (x.size() != y.size()) {
+        throw std::invalid_argument("X and Y data vectors must have the same size");
+    }
+    if (x.empty()) return;
+
+    bool wasOnGraph = dataOnGraph();
+    trace = trace.appended(x, y);
+    dataLod.append(trace.x(), trace.y());
+
+    if (asyncRender) {
+        requestTraceFrame();
+        return;
+    }
+    if (gpuRender) {
+        glScatter->setData(trace);  // uploads just the new samples
+        refresh(dataLayer);
+        return;
+    }
+    if (dataOnFrames()) {
+        // Past the threshold unsorted; the pyramid cannot serve it
+        if (wasOnGraph) {
+            showData();
+        } else if (!densityShown) {
+            requestTraceFrame();
         }
+    } else if (useLod()) {
+        updateVisibleData();
+    } else {
+        // Only the new points are merged into the graph
+        dataGraph->data()->add(*GraphDataFill::fromSpans(x, y));
+    }
+    densityStale = true;
+    // The ranges stay put, so the fit curves' buffer is still good
+    refresh(dataLayer);
+}
+
+bool PlotWidgetImpl::useLod() const {
+    return trace.size() > kLodThreshold && dataLod.sorted();
+}
+
+bool PlotWidgetImpl::dataOnFrames() const {
+    // A large unsorted trace too: the graph would need all of it copied
+    return asyncRender || (!gpuRender && trace.size() > kLodThreshold && !dataLod.sorted());
+}
+
+bool PlotWidgetImpl::dataOnGraph() const {
+    return !dataOnFrames() && !gpuRender;
+}
 
-        // Update previous parameters for next segment
-        prev_amplitude = amplitude;
-        prev_frequency = frequency;
-        prev_phase = phase;
-        prev_offset = offset;
+void PlotWidgetImpl::showData() {
+    bool onFrames = dataOnFrames();
+    if (onFrames) createTraceRenderer();
+    dataGraph->setVisible(dataOnGraph() && !densityShown);
+    if (traceFrame) traceFrame->setVisible(onFrames && !densityShown);
+    if (glScatter) glScatter->setVisible(gpuRender);
+
+    if (onFrames) {
+        dataGraph->data()->clear();  // the frames replace it
+        requestTraceFrame();
+    } else if (gpuRender) {
+        dataGraph->data()->clear();  // the vertex buffer replaces it
+        glScatter->setData(trace);
+    } else {
+        if (traceFrame) traceFrame->clear();
+        if (useLod()) {
+            updateVisibleData();
+        } else {
+            showAllData();
+        }
     }
+}
 
-    // Set data to the scatter graph
-    dataGraph->setData(x_vec, y_vec);
+void PlotWidgetImpl::showAllData() {
+    auto order = dataLod.sorted() ? GraphDataFill::Order::Ascending : GraphDataFill::Order::Unknown;
+    dataGraph->setData(GraphDataFill::fromSpans(trace.x(), trace.y(), order));
+}
 
-    updateAxisRanges();
-    customPlot->replot();
+void PlotWidgetImpl::updateVisibleData() {
+    // About two points per pixel column, found in O(columns * log N) instead
+    // of QCustomPlot's adaptive sampling walking every visible sample
+    QCPRange range = customPlot->xAxis->range();
+    size_t columns = static_cast<size_t>(std::max(1, customPlot->axisRect()->width()));
+    lodColumns = columns;
+    auto indices = dataLod.visibleIndices(trace.x(), trace.y(), range.lower, range.upper, columns);
+    dataGraph->setData(GraphDataFill::fromIndices(trace.x(), trace.y(), indices, GraphDataFill::Order::Ascending));
 }
 
-void PlotWidgetImpl::setFitData(const std::vector<double>& fit_x, const std::vector<double>& fit_y) {
-    QVector<double> x_vec, y_vec;
+void PlotWidgetImpl::requestTraceFrame() {
+    requestedXRange = customPlot->xAxis->range();
+    requestedYRange = customPlot->yAxis->range();
+    requestedRect = customPlot->axisRect()->rect();
+    if (trace.empty() || requestedRect.isEmpty()) {
+        traceFrame->clear();
+        return;
+    }
+
+    // The renderer gets handles and settings only; it never touches the graph
+    AsyncTraceRenderer::Request request;
+    request.data = trace;
+    if (useLod()) {
+        request.indices = dataLod.visibleIndices(trace.x(), trace.y(), requestedXRange.lower, requestedXRange.upper,
+                                                 static_cast<size_t>(requestedRect.width()));
+    }
+    request.xRange = requestedXRange;
+    request.yRange = requestedYRange;
+    request.size = requestedRect.size();
+    request.devicePixelRatio = customPlot->devicePixelRatioF();
+    request.scatter = dataGraph->scatterStyle();
+    request.pen = dataGraph->pen();
+    request.antialiased = dataGraph->antialiasedScatters();
+    traceRenderer->request(std::move(request));
+}
 
-    for (size_t i = 0; i < fit_x.size(); ++i) {
-        x_vec.append(fit_x[i]);
-        y_vec.append(fit_y[i]);
+void PlotWidgetImpl::createTraceRenderer() {
+    if (traceRenderer) return;
+    // Under the main layer, so the fit curves stay on top of the data
+    customPlot->addLayer("traceFrame", dataLayer, QCustomPlot::limBelow);
+    customPlot->layer("traceFrame")->setMode(QCPLayer::lmBuffered);
+    traceFrame = new TraceFrameItem(customPlot, customPlot->xAxis, customPlot->yAxis, "traceFrame");
+    // Kept for the widget's lifetime so frame ids only ever increase
+    traceRenderer = std::make_unique<AsyncTraceRenderer>(this, [this](AsyncTraceRenderer::Frame frame) {
+        if (!dataOnFrames()) return;
+        traceFrame->setFrame(std::move(frame));
+        // A new frame changes nothing else on the plot
+        refresh(traceFrame->layer());
+    });
+}
+
+void PlotWidgetImpl::setAsyncRendering(bool enabled) {
+    if (enabled == asyncRender) return;
+    if (enabled) setGpuScatter(false);
+
+    asyncRender = enabled;
+    showData();
+    updateDensity();
+
+    // A synchronous repaint per replot is exactly what this mode avoids
+    customPlot->setPlottingHint(QCP::phImmediateRefresh, !enabled);
+    refresh();
+}
+
+bool PlotWidgetImpl::asyncRendering() const {
+    return asyncRender;
+}
+
+void PlotWidgetImpl::setGpuScatter(bool enabled) {
+    if (enabled == gpuRender) return;
+    if (enabled) setAsyncRendering(false);
+
+    if (enabled && !glScatter) {
+        glScatter = new GlScatterPlottable(customPlot->xAxis, customPlot->yAxis);
+        glScatter->setLayer(dataLayer);
+        glScatter->setScatterStyle(dataGraph->scatterStyle());
+        glScatter->setPen(dataGraph->pen());
+    }
+
+    gpuRender = enabled;
+    if (!enabled) glScatter->setData(DataSet());
+    showData();
+    updateDensity();
+    refresh(dataLayer);
+}
+
+bool PlotWidgetImpl::gpuScatter() const {
+    return gpuRender;
+}
+
+void PlotWidgetImpl::setDensityMode(DensityMode mode) {
+    if (mode == densityPolicy) return;
+    densityPolicy = mode;
+    updateDensity();
+    refresh(dataLayer);
+}
+
+PlotWidgetImpl::DensityMode PlotWidgetImpl::densityMode() const {
+    return densityPolicy;
+}
+
+bool PlotWidgetImpl::wantDensity() const {
+    if (asyncRender || gpuRender || trace.empty() || densityPolicy == DensityMode::Off) return false;
+    if (densityPolicy == DensityMode::Always) return true;
+
+    // An unsorted trace counts in full rather than being scanned for the
+    // visible part
+    QCPRange range = customPlot->xAxis->range();
+    size_t visible = dataLod.sorted() ? DensityGrid::visibleCount(trace.x(), range.lower, range.upper) : trace.size();
+    double marker = dataGraph->scatterStyle().size();
+    double covered = static_cast<double>(visible) * marker * marker;
+    QRect rect = customPlot->axisRect()->rect();
+    double area = static_cast<double>(rect.width()) * rect.height();
+    // Back to markers only well below the switch, so it does not flicker
+    return densityShown ? covered > area / 2 : covered > area;
+}
+
+bool PlotWidgetImpl::updateDensity() {
+    densityStale = false;
+    densitySize = customPlot->axisRect()->rect().size();
+    bool show = wantDensity();
+    bool changed = show && fillDensityMap();
+    if (show != densityShown) {
+        densityShown = show;
+        densityMap->setVisible(show);
+        dataGraph->setVisible(!show && dataOnGraph());
+        if (traceFrame) traceFrame->setVisible(!show && dataOnFrames());
+        // The graph's view and the frames were left alone under the map
+        if (!show && useLod() && dataOnGraph()) updateVisibleData();
+        if (!show && dataOnFrames()) requestTraceFrame();
+        changed = true;
+    }
+    return changed;
+}
+
+bool PlotWidgetImpl::fillDensityMap() {
+    if (!densityMap) {
+        densityMap = new QCPColorMap(customPlot->xAxis, customPlot->yAxis);
+        densityMap->setLayer(dataLayer);
+        densityMap->setSelectable(QCP::stNone);
+        densityMap->setInterpolate(false);
+        densityMap->setTightBoundary(true);
+        QCPColorGradient gradient(QCPColorGradient::gpThermal);
+        gradient.setNanHandling(QCPColorGradient::nhTransparent);  // empty cells
+        densityMap->setGradient(gradient);
+        // Counts run from single outliers to the thousands in the core
+        densityMap->setDataScaleType(QCPAxis::stLogarithmic);
+        densityMap->setVisible(false);
+    }
+
+    QCPRange xRange = customPlot->xAxis->range();
+    QCPRange yRange = customPlot->yAxis->range();
+    QRect rect = customPlot->axisRect()->rect();
+    DensityGrid::Window window{xRange.lower, xRange.upper, yRange.lower, yRange.upper,
+                               static_cast<size_t>(std::max(0, rect.width())),
+                               static_cast<size_t>(std::max(0, rect.height()))};
+    if (!density.update(trace.x(), trace.y(), dataLod.sorted(), trace.generation(), window)) return false;
+
+    int columns = static_cast<int>(density.columns());
+    int rows = static_cast<int>(density.rows());
+    QCPColorMapData* cells = densityMap->data();
+    cells->setSize(columns, rows);
+    // The map's range runs from the first cell's centre to the last one's
+    double width = density.cellWidth();
+    double height = density.cellHeight();
+    cells->setRange(QCPRange(density.keyOrigin() + width / 2, density.keyOrigin() + (columns - 0.5) * width),
+                    QCPRange(density.valueOrigin() + height / 2, density.valueOrigin() + (rows - 0.5) * height));
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            uint32_t count = density.at(static_cast<size_t>(column), static_cast<size_t>(row));
+            cells->setCell(column, row, count ? count : qQNaN());
+        }
+    }
+    densityMap->setDataRange(QCPRange(1, std::max<uint32_t>(2, density.maxCount())));
+    return true;
+}
+
+FrameScheduler::Stats PlotWidgetImpl::frameStats() const {
+    return frames->stats();
+}
+
+void PlotWidgetImpl::refresh(QCPLayer* layer) {
+    if (layer) {
+        layers->invalidate(layer);
+    } else {
+        layers->invalidateAll();
     }
+    frames->schedule();
+}
+
+uint64_t PlotWidgetImpl::dataGeneration() const {
+    return trace.generation();
+}
 
-    fitGraph->setData(x_vec, y_vec);
-    customPlot->replot();
+void PlotWidgetImpl::setFitData(const std::vector<double>& fit_x, const std::vector<double>& fit_y) {
+    setFitData(GraphDataFill::fromSpans(fit_x, fit_y));
+}
+
+void PlotWidgetImpl::setFitData(QSharedPointer<QCPGraphDataContainer> data) {
+    fitGraph->setData(std::move(data));
+    refresh(fitLayer);
 }
 
 
+DataSet PlotWidgetImpl::dataSet() const {
+    return trace;
+}
+
 std::vector<double> PlotWidgetImpl::getXData() const {
-    return x_data;
+    return {trace.x().begin(), trace.x().end()};
 }
 
 std::vector<double> PlotWidgetImpl::getYData() const {
-    return y_data;
+    return {trace.y().begin(), trace.y().end()};
 }
 
 void PlotWidgetImpl::zoomIn() {
     // Scale both axes by 0.8 (zoom in by reducing the range by 20%)
     customPlot->xAxis->scaleRange(0.8);
     customPlot->yAxis->scaleRange(0.8);
-    customPlot->replot();
+    refresh();
 }
 
 
@@ -315,14 +566,14 @@ void PlotWidgetImpl::zoomOut() {
     // Scale both axes by 1.2 (zoom out by increasing the range by 20%)
     customPlot->xAxis->scaleRange(1.2);
     customPlot->yAxis->scaleRange(1.2);
-    customPlot->replot();
+    refresh();
 }
 
 
 void PlotWidgetImpl::resetZoom() {
     customPlot->xAxis->setRange(initialXMin, initialXMax);
     customPlot->yAxis->setRange(initialYMin, initialYMax);
-    customPlot->replot();
+    refresh();
 }
 
 void PlotWidgetImpl::updateAxisRanges() {
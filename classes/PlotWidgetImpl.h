@@ -1,16 +1,33 @@
 // PlotWidgetImpl.h - Internal implementation with Qt headers
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <random>
 #include <vector>
+#include "AsyncTraceRenderer.h"
+#include "DataSet.h"
+#include "DensityGrid.h"
+#include "FrameScheduler.h"
+#include "MinMaxPyramid.h"
 #include "qcustomplot_wrapper.h"
 
+class GlScatterPlottable;
+class TraceFrameItem;
+
 class PlotWidgetImpl : public QWidget {
     Q_OBJECT
 
 public:
     explicit PlotWidgetImpl(QWidget* parent = nullptr);
     void generateSineData();
+    // Adds samples after the existing ones; dataGeneration() stays the same
+    void appendData(const std::vector<double>& x, const std::vector<double>& y);
+    // Changes whenever the data is replaced, so consumers can sync incrementally
+    uint64_t dataGeneration() const;
     void setFitData(const std::vector<double>& fit_x, const std::vector<double>& fit_y);
+    // Snapshot of the plotted trace: no copy, unaffected by later changes
+    DataSet dataSet() const;
+    // Copies of the trace, for callers that need owning vectors
     std::vector<double> getXData() const;
     std::vector<double> getYData() const;
     void zoomIn();
@@ -18,7 +35,26 @@ public:
     void resetZoom();
     void setCppFitData(const std::vector<double>& fit_x, const std::vector<double>& fit_y);
     void setPythonFitData(const std::vector<double>& fit_x, const std::vector<double>& fit_y);
+    // Take a prepared container (see GraphDataFill) without copying it
+    void setFitData(QSharedPointer<QCPGraphDataContainer> data);
+    void setCppFitData(QSharedPointer<QCPGraphDataContainer> data);
+    void setPythonFitData(QSharedPointer<QCPGraphDataContainer> data);
     void clearFitData();
+    // Draws the data trace on a worker thread; the plot shows the newest
+    // finished frame and never waits for one
+    void setAsyncRendering(bool enabled);
+    bool asyncRendering() const;
+    // Draws the data points from a GPU vertex buffer in one call; the
+    // two modes replace each other
+    void setGpuScatter(bool enabled);
+    bool gpuScatter() const;
+    // Where markers would pile up, Auto draws a per-pixel count map of the
+    // samples instead; either way it only applies to the plain graph mode
+    enum class DensityMode { Off, Auto, Always };
+    void setDensityMode(DensityMode mode);
+    DensityMode densityMode() const;
+    // How plot updates were folded into frames so far
+    FrameScheduler::Stats frameStats() const;
 
 
 protected:
@@ -38,10 +74,41 @@ private:
     QCPGraph* fitGraph;       // For fit curve
     QCPGraph* cppFitGraph;
     QCPGraph* pythonFitGraph;
-    std::vector<double> x_data;
-    std::vector<double> y_data;
+    // Buffered separately so each can be redrawn without the other
+    QCPLayer* dataLayer;
+    QCPLayer* fitLayer;
+    std::unique_ptr<LayerDirtyTracker> layers;
+    std::unique_ptr<FrameScheduler> frames;  // declared after, destroyed before
+    // Shared with the renderers. The data graph copies a trace of up to
+    // kLodThreshold samples, or the visible view of a larger sorted one;
+    // larger unsorted traces are drawn as frames instead.
+    DataSet trace;
     std::mt19937 rng;
 
+    // Above this many samples the data graph only holds what the view needs
+    static constexpr size_t kLodThreshold = 20000;
+    MinMaxPyramid dataLod;
+    size_t lodColumns = 0;  // axis rect width the graph's view was built for
+
+    // Asynchronous rendering of the data trace; both created on first use,
+    // by the async mode or by a large unsorted trace
+    std::unique_ptr<AsyncTraceRenderer> traceRenderer;
+    TraceFrameItem* traceFrame = nullptr;
+    bool asyncRender = false;
+    QCPRange requestedXRange;
+    QCPRange requestedYRange;
+    QRect requestedRect;
+
+    GlScatterPlottable* glScatter = nullptr;  // created on first use
+    bool gpuRender = false;
+
+    DensityGrid density;
+    QCPColorMap* densityMap = nullptr;  // created on first use
+    DensityMode densityPolicy = DensityMode::Auto;
+    bool densityShown = false;
+    bool densityStale = false;  // the view or the trace changed since
+    QSize densitySize;  // axis rect size the map was decided for
+
     // Zoom and pan state
     double initialXMin;
     double initialXMax;
@@ -56,4 +123,19 @@ private:
     void setupPlot();
     void setupUI();
     void updateAxisRanges();
+    // Marks `layer` (every layer when null) for the next frame
+    void refresh(QCPLayer* layer = nullptr);
+    bool useLod() const;
+    bool dataOnFrames() const;
+    bool dataOnGraph() const;
+    // Puts the trace on whichever of graph, frames or vertex buffer draws it
+    void showData();
+    void showAllData();
+    void createTraceRenderer();
+    void updateVisibleData();
+    void requestTraceFrame();
+    bool wantDensity() const;
+    // Returns true if the data layer needs redrawing
+    bool updateDensity();
+    bool fillDensityMap();
 };
\ No newline at end of file
@@ -14,6 +14,10 @@ void PlotWidgetWrapper::generateSineData() {
     impl->generateSineData();
 }
 
+void PlotWidgetWrapper::appendData(const std::vector<double>& x, const std::vector<double>& y) {
+    impl->appendData(x, y);
+}
+
 void PlotWidgetWrapper::setFitData(const std::vector<double>& fit_x, const std::vector<double>& fit_y) {
     impl->setFitData(fit_x, fit_y);
 }
@@ -13,6 +13,7 @@ public:
 
     // Same interface as your original class
     void generateSineData();
+    void appendData(const std::vector<double>& x, const std::vector<double>& y);
     void setFitData(const std::vector<double>& fit_x, const std::vector<double>& fit_y);
     std::vector<double> getXData() const;
     std::vector<double> getYData() const;
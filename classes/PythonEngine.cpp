@@ -1,97 +1,88 @@
-
 #include "../classes/PythonEngine.h"
+#include "ScriptResultSchema.h"
+#include "fitting_bindings.h"
 #include <stdexcept>
 #include <iostream>
-
-PythonEngine::PythonEngine() = default;
-
-PythonEngine::~PythonEngine() {
-    // No need to restore cout/cerr buffers since we're not redirecting them
+#include <cstdlib>
+#include <filesystem>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <tuple>
+
+namespace {
+
+// Copies `values` into the float64 buffer from sample `at` on. When they do
+// not fit, they go into a new buffer of at least twice the size instead, so
+// views taken of the old one keep it alive and never see it change.
+void storeSamples(pybind11::object& buffer, size_t at, std::span<const double> values) {
+    size_t capacity = buffer ? static_cast<size_t>(PyByteArray_GET_SIZE(buffer.ptr())) / sizeof(double) : 0;
+    size_t needed = at + values.size();
+    if (needed > capacity) {
+        size_t grown = std::max(needed, 2 * capacity);
+        auto fresh = pybind11::reinterpret_steal<pybind11::object>(
+            PyByteArray_FromStringAndSize(nullptr, static_cast<Py_ssize_t>(grown * sizeof(double))));
+        if (!fresh) throw pybind11::error_already_set();
+        if (at > 0) std::memcpy(PyByteArray_AS_STRING(fresh.ptr()), PyByteArray_AS_STRING(buffer.ptr()), at * sizeof(double));
+        buffer = std::move(fresh);
+    }
+    if (!values.empty()) {
+        std::memcpy(PyByteArray_AS_STRING(buffer.ptr()) + at * sizeof(double), values.data(), values.size() * sizeof(double));
+    }
 }
 
-void PythonEngine::setOutputWidget(QTextEdit* outputWidget) {
-    this->outputWidget = outputWidget;
+const double* samplesOf(const pybind11::object& buffer) {
+    return reinterpret_cast<const double*>(PyByteArray_AS_STRING(buffer.ptr()));
 }
 
-void PythonEngine::initialize() {
-    if (initialized) return;
-
-    try {
-        guard = std::make_unique<pybind11::scoped_interpreter>();
-        main_module = pybind11::module_::import("__main__");
+// The first `size` samples as a read-only float64 memoryview; np.asarray()
+// wraps it without copying
+pybind11::object readOnlyView(const pybind11::object& buffer, size_t size) {
+    auto bytes = pybind11::reinterpret_steal<pybind11::object>(PyMemoryView_FromObject(buffer.ptr()));
+    if (!bytes) throw pybind11::error_already_set();
+    pybind11::object samples = bytes.attr("cast")("d");
+    return samples[pybind11::slice(0, static_cast<pybind11::ssize_t>(size), 1)].attr("toreadonly")();
+}
 
-        // Create a Python class that captures output and sends it to Qt
-        pybind11::exec(R"(
-import sys
-import io
-
-class QtOutputCapture:
-    def __init__(self):
-        self.output_buffer = []
-
-    def write(self, text):
-        if text and text.strip():  # Only capture non-empty text
-            self.output_buffer.append(text)
-        return len(text) if text else 0
-
-    def flush(self):
-        if self.output_buffer:
-            # Join all buffered output and send it
-            full_text = ''.join(self.output_buffer)
-            self.output_buffer.clear()
-            # This will be called from C++ to get the output
-            return full_text
-        return ""
-
-    def get_and_clear_output(self):
-        if self.output_buffer:
-            full_text = ''.join(self.output_buffer)
-            self.output_buffer.clear()
-            return full_text
-        return ""
-
-# Create the capture instance
-_qt_output_capture = QtOutputCapture()
-
-# Store original streams
-_original_stdout = sys.stdout
-_original_stderr = sys.stderr
-
-# Redirect Python output to our capture
-sys.stdout = _qt_output_capture
-sys.stderr = _qt_output_capture
-
-print("Python output capture initialized successfully")
-)");
-
-        // Cross-platform Python path discovery and module initialization
-        pybind11::exec(R"(
+// Core path setup: restores the discovered site-packages paths from a JSON
+// cache keyed on the interpreter build, and only probes the filesystem on a miss.
+const char* kPathSetupScript = R"(
 import sys
 import os
-import site
-import platform
-from pathlib import Path
+import json
 
-def discover_python_paths():
+def _path_cache_key():
+    return f"{sys.version}|{sys.prefix}|{sys.exec_prefix}"
+
+def _discover_python_paths(verbose=False):
     """Discover Python paths in a cross-platform way"""
+    import site
+    import platform
+
+    def report(message):
+        if verbose:
+            print(message)
+
     paths_to_add = []
 
     # Get system information
     system = platform.system().lower()
     python_version = f"{sys.version_info.major}.{sys.version_info.minor}"
 
-    print(f"System: {system}")
-    print(f"Python version: {python_version}")
-    print(f"Python executable: {sys.executable}")
+    report(f"System: {system}")
+    report(f"Python version: {python_version}")
+    report(f"Python executable: {sys.executable}")
 
     # Use site module to get user site packages (cross-platform)
     try:
         user_site = site.getusersitepackages()
         if user_site and os.path.exists(user_site):
             paths_to_add.append(user_site)
-            print(f"✓ Found user site packages: {user_site}")
+            report(f"✓ Found user site packages: {user_site}")
     except Exception as e:
-        print(f"⚠ Could not get user site packages: {e}")
+        report(f"⚠ Could not get user site packages: {e}")
 
     # Get site packages from site module (system-wide)
     try:
@@ -99,9 +90,9 @@ def discover_python_paths():
         for path in site_packages:
             if os.path.exists(path):
                 paths_to_add.append(path)
-                print(f"✓ Found site packages: {path}")
+                report(f"✓ Found site packages: {path}")
     except Exception as e:
-        print(f"⚠ Could not get site packages: {e}")
+        report(f"⚠ Could not get site packages: {e}")
 
     # Platform-specific additional paths
     if system == "windows":
@@ -141,32 +132,135 @@ def discover_python_paths():
             for matching_path in matching_paths:
                 if os.path.exists(matching_path):
                     paths_to_add.append(matching_path)
-                    print(f"✓ Found additional path: {matching_path}")
+                    report(f"✓ Found additional path: {matching_path}")
         else:
             if os.path.exists(path):
                 paths_to_add.append(path)
-                print(f"✓ Found additional path: {path}")
+                report(f"✓ Found additional path: {path}")
 
     return paths_to_add
 
-def add_python_paths():
-    """Add discovered Python paths to sys.path"""
-    discovered_paths = discover_python_paths()
+def _add_python_paths(paths):
+    """Add paths to sys.path, returning how many were new"""
     paths_added = 0
-
-    for path in discovered_paths:
+    for path in paths:
         if path not in sys.path:
             sys.path.insert(0, path)
             paths_added += 1
+    return paths_added
 
-    if paths_added == 0:
-        print("ℹ No additional Python paths needed to be added")
-    else:
-        print(f"✓ Added {paths_added} paths to Python path")
+def _discover_and_cache_paths(cache_file, verbose=False):
+    """Run the full discovery, apply it and write the result to the cache"""
+    discovered_paths = _discover_python_paths(verbose)
+    paths_added = _add_python_paths(discovered_paths)
+
+    try:
+        os.makedirs(os.path.dirname(cache_file), exist_ok=True)
+        with open(cache_file, "w", encoding="utf-8") as f:
+            json.dump({"key": _path_cache_key(), "paths": discovered_paths}, f, indent=2)
+    except OSError as e:
+        print(f"⚠ Could not write Python path cache {cache_file}: {e}")
 
     return paths_added
 
-def check_essential_modules():
+def _setup_python_paths(cache_file):
+    """Restore sys.path additions from the cache, discovering them on a miss"""
+    try:
+        with open(cache_file, "r", encoding="utf-8") as f:
+            cache = json.load(f)
+        if cache.get("key") == _path_cache_key():
+            cached_paths = [p for p in cache.get("paths", []) if os.path.isdir(p)]
+            paths_added = _add_python_paths(cached_paths)
+            print(f"Python paths restored from cache ({paths_added} added)")
+            return
+    except (OSError, ValueError):
+        pass
+
+    paths_added = _discover_and_cache_paths(cache_file)
+    print(f"Python paths discovered and cached ({paths_added} added)")
+)";
+
+// Helpers for the isolated per-run namespaces and memory tracing
+const char* kNamespaceHelpersScript = R"(
+import sys
+import builtins
+
+def _new_run_namespace():
+    return {"__name__": "__main__", "__builtins__": builtins}
+
+def _namespace_retained_bytes(namespace):
+    """Approximate memory held by the data values of a run namespace"""
+    total = 0
+    count = 0
+    seen = set()
+    for name, value in namespace.items():
+        if name.startswith('__') or id(value) in seen:
+            continue
+        if callable(value) or isinstance(value, type(sys)):
+            continue
+        seen.add(id(value))
+        count += 1
+        nbytes = getattr(value, "nbytes", None)
+        if isinstance(nbytes, int):
+            total += nbytes
+            continue
+        total += sys.getsizeof(value)
+        if isinstance(value, (list, tuple)) and value:
+            # Extrapolate element sizes from a sample to keep this O(1) per value
+            sample = value[:256]
+            total += sum(sys.getsizeof(v) for v in sample) * len(value) // len(sample)
+    return count, total
+
+def _memory_trace_start(frames):
+    """Trace this run's allocations; False if tracemalloc was already on"""
+    import tracemalloc
+    if tracemalloc.is_tracing():
+        return False
+    tracemalloc.start(frames)
+    return True
+
+def _memory_trace_stop(owned):
+    """Traced peak in bytes; stops tracing if the engine started it"""
+    import tracemalloc
+    if not tracemalloc.is_tracing():
+        return 0
+    peak = tracemalloc.get_traced_memory()[1]
+    if owned:
+        tracemalloc.stop()
+    return peak
+
+def _memory_top_sites(limit):
+    """Largest live traced allocations by line, as (location, bytes, blocks)"""
+    import tracemalloc
+    if not tracemalloc.is_tracing():
+        return []
+    snapshot = tracemalloc.take_snapshot().filter_traces((
+        tracemalloc.Filter(False, tracemalloc.__file__),
+        tracemalloc.Filter(False, "<frozen importlib._bootstrap*>"),
+        tracemalloc.Filter(False, "<unknown>"),
+    ))
+    return [(f"{stat.traceback[0].filename}:{stat.traceback[0].lineno}", stat.size, stat.count)
+            for stat in snapshot.statistics("lineno")[:limit]]
+)";
+
+// Contiguous float64 buffers (NumPy arrays) are copied with a single memcpy;
+// anything else goes through the generic sequence conversion
+std::vector<double> toDoubleVector(const pybind11::handle& value) {
+    if (pybind11::isinstance<pybind11::buffer>(value)) {
+        auto info = pybind11::reinterpret_borrow<pybind11::buffer>(value).request();
+        if (info.ndim == 1 && info.format == pybind11::format_descriptor<double>::format() &&
+            (info.shape[0] <= 1 || info.strides[0] == static_cast<pybind11::ssize_t>(sizeof(double)))) {
+            auto* begin = static_cast<const double*>(info.ptr);
+            return std::vector<double>(begin, begin + info.shape[0]);
+        }
+    }
+    return value.cast<std::vector<double>>();
+}
+
+// Verbose diagnostics, only run on request: rediscovers paths and imports the
+// scientific stack to report versions.
+const char* kDiagnosticsScript = R"(
+def _check_essential_modules():
     """Check for essential modules in a cross-platform way"""
     modules_status = []
 
@@ -203,47 +297,222 @@ def check_essential_modules():
 
     return modules_status
 
-# Execute the path discovery and module checking
-print("=" * 60)
-print("Python Engine Cross-Platform Initialization")
-print("=" * 60)
+def _run_diagnostics(cache_file):
+    print("=" * 60)
+    print("Python Engine Diagnostics")
+    print("=" * 60)
+
+    paths_added = _discover_and_cache_paths(cache_file, verbose=True)
+    if paths_added == 0:
+        print("ℹ No additional Python paths needed to be added")
+    else:
+        print(f"✓ Added {paths_added} paths to Python path")
+    print(f"Path cache: {cache_file}")
+
+    print("\nChecking essential modules:")
+    print("-" * 30)
+    for status in _check_essential_modules():
+        print(status)
+
+    print("\nPython path information:")
+    print("-" * 25)
+    print(f"Total paths in sys.path: {len(sys.path)}")
+    print("First 5 paths:")
+    for i, path in enumerate(sys.path[:5]):
+        print(f"  {i+1}. {path}")
+
+    print("=" * 60)
+)";
+
+// Filename scripts are compiled under; tracebacks and line profiles use it
+constexpr const char* kScriptFilename = "<script>";
+
+// Drain budget per call keeps a chatty script from stalling the host; a line
+// longer than kMaxPendingLine is shown without waiting for its newline
+constexpr size_t kMaxDrainBytes = 256 * 1024;
+constexpr size_t kMaxPendingLine = 64 * 1024;
+
+constexpr size_t kTopAllocationSites = 10;
+
+// Builds a diagnostic from streamable parts
+template <typename... Parts>
+std::string message(const Parts&... parts) {
+    std::ostringstream out;
+    (out << ... << parts);
+    return out.str();
+}
+
+// Replacement for sys.stdout/sys.stderr: each write is copied as UTF-8
+// straight into the engine's output ring, so nothing accumulates in Python
+struct OutputStream {
+    OutputRingBuffer* ring = nullptr;
+
+    size_t write(const pybind11::str& text) {
+        Py_ssize_t size = 0;
+        const char* utf8 = PyUnicode_AsUTF8AndSize(text.ptr(), &size);
+        if (utf8) {
+            ring->write(utf8, static_cast<size_t>(size));
+        } else {
+            // Lone surrogates cannot be encoded strictly
+            PyErr_Clear();
+            ring->write(text.attr("encode")("utf-8", "replace").cast<std::string>());
+        }
+        return static_cast<size_t>(PyUnicode_GET_LENGTH(text.ptr()));
+    }
+};
+
+}
+
+PYBIND11_EMBEDDED_MODULE(_cpppython_io, m) {
+    pybind11::class_<OutputStream>(m, "OutputStream")
+        .def("write", &OutputStream::write)
+        .def("flush", [](OutputStream&) {})
+        .def("isatty", [](OutputStream&) { return false; })
+        .def("writable", [](OutputStream&) { return true; })
+        .def_property_readonly("encoding", [](OutputStream&) { return "utf-8"; });
+}
+
+// Scripts reach the native kernels with `import fitting`
+PYBIND11_EMBEDDED_MODULE(fitting, m) {
+    bindFitting(m);
+}
+
+PythonEngine::PythonEngine()
+    : outputRing(std::make_unique<OutputRingBuffer>()) {
+}
+
+PythonEngine::~PythonEngine() {
+    // The warm-up thread needs the GIL, so it must finish before we take it back
+    if (warmupThread.joinable()) {
+        warmupThread.join();
+    }
+    gilRelease.reset();
+    profiler.reset();
+    runNamespace = pybind11::object();
+    dataX = pybind11::object();
+    dataY = pybind11::object();
+    dataXView = pybind11::object();
+    dataYView = pybind11::object();
+    main_module = pybind11::module_();
+}
+
+void PythonEngine::setSink(std::shared_ptr<EngineSink> sink) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    this->sink = std::move(sink);
+}
+
+void PythonEngine::setOutputCapacity(size_t bytes) {
+    if (initialized) {
+        throw std::logic_error("Output capacity must be set before the Python engine is initialized");
+    }
+    outputRing = std::make_unique<OutputRingBuffer>(bytes);
+}
+
+void PythonEngine::setOutputBackpressure(OutputRingBuffer::Backpressure policy) {
+    outputRing->setBackpressure(policy);
+}
+
+void PythonEngine::setOutputMuted(bool muted) {
+    outputMuted = muted;
+    outputRing->setMuted(muted);
+}
 
-add_python_paths()
+void PythonEngine::report(EngineSink::Kind kind, const std::string& text) {
+    if (outputMuted) return;
+    drainOutput(true);
+    std::lock_guard<std::mutex> lock(outputMutex);
+    if (sink) {
+        sink->write(kind, text);
+    }
+}
 
-print("\nChecking essential modules:")
-print("-" * 30)
-module_statuses = check_essential_modules()
-for status in module_statuses:
-    print(status)
+std::string PythonEngine::pathCacheFile() {
+    std::filesystem::path base;
+#ifdef _WIN32
+    const char* cacheRoot = std::getenv("LOCALAPPDATA");
+#else
+    const char* cacheRoot = std::getenv("XDG_CACHE_HOME");
+#endif
+    if (cacheRoot && *cacheRoot) {
+        base = cacheRoot;
+    } else if (const char* home = std::getenv("HOME")) {
+        base = std::filesystem::path(home) / ".cache";
+    } else {
+        base = std::filesystem::temp_directory_path();
+    }
+    return (base / "cpppython" / "python_paths.json").string();
+}
 
-print("\nPython path information:")
-print("-" * 25)
-print(f"Total paths in sys.path: {len(sys.path)}")
-print("First 5 paths:")
-for i, path in enumerate(sys.path[:5]):
-    print(f"  {i+1}. {path}")
+void PythonEngine::initialize() {
+    if (initialized) return;
 
-print("=" * 60)
-print("Python engine initialization complete")
-print("=" * 60)
-)");
+    try {
+        guard = std::make_unique<pybind11::scoped_interpreter>();
+        main_module = pybind11::module_::import("__main__");
 
-        // Capture and display the initialization output
-        captureAndDisplayPythonOutput();
+        // Route Python output into the ring; the host drains it while scripts run
+        pybind11::module_::import("_cpppython_io");
+        pybind11::object stream = pybind11::cast(OutputStream{outputRing.get()});
+        auto sys = pybind11::module_::import("sys");
+        sys.attr("stdout") = stream;
+        sys.attr("stderr") = stream;
+        pybind11::print("Python output capture initialized successfully");
+
+        // Only the cached sys.path is applied here; module imports and the
+        // verbose platform probing are deferred to prewarm()/runDiagnostics()
+        pybind11::exec(kPathSetupScript, main_module.attr("__dict__"));
+        main_module.attr("_setup_python_paths")(pathCacheFile());
+        pybind11::exec(kNamespaceHelpersScript, main_module.attr("__dict__"));
+        pybind11::exec(ScriptResultSchema::pythonHelpers(), main_module.attr("__dict__"));
 
         initialized = true;
 
+        // From here on every engine call takes the GIL explicitly
+        gilRelease = std::make_unique<pybind11::gil_scoped_release>();
+
     } catch (const std::exception& e) {
         throw std::runtime_error(std::string("Failed to initialize Python: ") + e.what());
     }
 }
 
+void PythonEngine::prewarm(const std::vector<std::string>& modules) {
+    if (!initialized) initialize();
+    if (warmupThread.joinable()) return;
+
+    warmupThread = std::thread([modules]() {
+        pybind11::gil_scoped_acquire gil;
+        for (const auto& name : modules) {
+            try {
+                pybind11::module_::import(name.c_str());
+            } catch (const pybind11::error_already_set&) {
+                // Missing optional modules are reported by runDiagnostics()
+            }
+        }
+    });
+}
+
+void PythonEngine::runDiagnostics() {
+    if (!initialized) initialize();
+    pybind11::gil_scoped_acquire gil;
+
+    try {
+        if (!main_module.attr("__dict__").contains("_run_diagnostics")) {
+            pybind11::exec(kDiagnosticsScript, main_module.attr("__dict__"));
+        }
+        main_module.attr("_run_diagnostics")(pathCacheFile());
+
+    } catch (const std::exception& e) {
+        report(EngineSink::Kind::Error, message("Diagnostics Error: ", e.what()));
+    }
+}
+
 bool PythonEngine::isInitialized() const {
     return initialized;
 }
 
-void PythonEngine::setData(const std::vector<double>& x_data, const std::vector<double>& y_data) {
+void PythonEngine::setData(std::span<const double> x_data, std::span<const double> y_data) {
     if (!initialized) initialize();
+    pybind11::gil_scoped_acquire gil;
 
     if (x_data.size() != y_data.size()) {
         throw std::runtime_error("X and Y data vectors must have the same size");
@@ -254,189 +523,262 @@ void PythonEngine::setData(const std::vector<double>& x_data, const std::vector<
     }
 
     try {
-        main_module.attr("x_data") = pybind11::cast(x_data);
-        main_module.attr("y_data") = pybind11::cast(y_data);
-        main_module.attr("data_size") = pybind11::cast(x_data.size());
+        auto marshal_start = std::chrono::high_resolution_clock::now();
+        uploadData(x_data, y_data);
+        source.reset();
+        profile.marshalIn = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - marshal_start);
 
         // Use Python print so it goes to our capture system
-        pybind11::exec("print(f'Data set successfully: {len(x_data)} points')", main_module.attr("__dict__"));
-        captureAndDisplayPythonOutput();
+        pybind11::print("Data set successfully:", dataSize, "points");
 
     } catch (const std::exception& e) {
         throw std::runtime_error(std::string("Failed to set data: ") + e.what());
     }
 }
 
+PythonEngine::DataSync PythonEngine::syncData(std::span<const double> x_data, std::span<const double> y_data,
+                                              uint64_t generation) {
+    if (!initialized) initialize();
+    pybind11::gil_scoped_acquire gil;
+
+    if (x_data.size() != y_data.size()) {
+        throw std::runtime_error("X and Y data vectors must have the same size");
+    }
+
+    if (x_data.empty()) {
+        throw std::runtime_error("Data vectors cannot be empty");
+    }
+
+    try {
+        auto marshal_start = std::chrono::high_resolution_clock::now();
+        DataSync sync = DataSync::Replaced;
+
+        // Same dataset, no shorter, and the last mirrored sample still matches:
+        // only the tail is new. The checks are cheap insurance against a caller
+        // that replaced its data without changing the generation, and against
+        // a buffer that was changed through a view's .obj.
+        if (source == generation && dataX && x_data.size() >= dataSize &&
+            static_cast<size_t>(PyByteArray_GET_SIZE(dataX.ptr())) >= dataSize * sizeof(double) &&
+            samplesOf(dataX)[dataSize - 1] == x_data[dataSize - 1]) {
+            sync = x_data.size() == dataSize ? DataSync::Unchanged : DataSync::Appended;
+        }
+
+        if (sync == DataSync::Appended) {
+            size_t added = x_data.size() - dataSize;
+            storeSamples(dataX, dataSize, x_data.subspan(dataSize));
+            storeSamples(dataY, dataSize, y_data.subspan(dataSize));
+            dataSize = x_data.size();
+            ++dataVersion;
+            pybind11::print("Data extended:", added, "new points,", dataSize, "total");
+        } else if (sync == DataSync::Replaced) {
+            uploadData(x_data, y_data);
+            pybind11::print("Data set successfully:", dataSize, "points");
+        }
+        source = generation;
+
+        profile.marshalIn = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - marshal_start);
+        return sync;
+
+    } catch (const std::exception& e) {
+        source.reset();  // the mirror may be half-extended; resend next time
+        throw std::runtime_error(std::string("Failed to set data: ") + e.what());
+    }
+}
+
+PythonEngine::DataSync PythonEngine::syncData(const DataSet& data) {
+    return syncData(data.x(), data.y(), data.generation());
+}
+
+uint64_t PythonEngine::dataGeneration() const {
+    return dataVersion;
+}
+
+void PythonEngine::uploadData(std::span<const double> x_data, std::span<const double> y_data) {
+    // Fresh buffers, so views from earlier runs keep the old samples
+    dataX = pybind11::object();
+    dataY = pybind11::object();
+    storeSamples(dataX, 0, x_data);
+    storeSamples(dataY, 0, y_data);
+    dataSize = x_data.size();
+    replacedAt = ++dataVersion;
+}
+
 void PythonEngine::executeScript(const std::string& script) {
     if (!initialized) initialize();
+    pybind11::gil_scoped_acquire gil;
 
     if (script.empty()) {
         throw std::runtime_error("Python script is empty");
     }
 
+    memory = MemoryReport{};
     try {
-        // Clear any previous results
-        clearPreviousResults();
+        pybind11::dict ns = prepareRunNamespace();
+
+        // Compile separately so compile time is not billed to the script
+        auto compile_start = std::chrono::high_resolution_clock::now();
+        auto code = pybind11::reinterpret_steal<pybind11::object>(
+            Py_CompileString(script.c_str(), kScriptFilename, Py_file_input));
+        if (!code) {
+            throw pybind11::error_already_set();
+        }
+        profile.compile = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - compile_start);
 
         // Execute the script
-        pybind11::exec(script, main_module.attr("__dict__"));
-
-        // Capture any output from the script execution
-        captureAndDisplayPythonOutput();
+        if (profiling != ProfileMode::Off) {
+            if (!profiler) profiler = std::make_unique<PythonProfiler>();
+            profiler->clear();
+            profiler->start(profiling == ProfileMode::Lines, kScriptFilename);
+        }
+        startMemoryWatch();
+        auto exec_start = std::chrono::high_resolution_clock::now();
+        auto outcome = pybind11::reinterpret_steal<pybind11::object>(
+            PyEval_EvalCode(code.ptr(), ns.ptr(), ns.ptr()));
+        // Stopping the watchdog is the host's cost, not the script's
+        lastExecTime = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - exec_start);
+        profile.execute = lastExecTime;
+        finishMemoryWatch();
+        if (profiling != ProfileMode::Off) {
+            profiler->stop();
+            profile.functions = profiler->functions();
+            profile.lines = profiler->lines();
+        }
+        if (!outcome) {
+            throw pybind11::error_already_set();
+        }
 
         // Print completion message
-        pybind11::exec("print('Script execution completed successfully')", main_module.attr("__dict__"));
-        captureAndDisplayPythonOutput();
+        pybind11::print("Script execution completed successfully");
+
+        reportRetainedMemory();
+        reportMemory();
+        drainOutput(true);
 
     } catch (const pybind11::error_already_set& e) {
         std::string error_msg = e.what();
+        reportMemory();
 
-        // Send error to Qt widget instead of console
-        if (outputWidget) {
-            QString qtError = QString("Python Execution Error: %1").arg(QString::fromStdString(error_msg));
-            outputWidget->append(qtError);
-        }
+        // Queue the error behind the script's own output
+        report(EngineSink::Kind::Error, "Python Execution Error: " + error_msg);
 
         throw std::runtime_error("Python script execution failed: " + error_msg);
     } catch (const std::exception& e) {
-        // Send error to Qt widget instead of console
-        if (outputWidget) {
-            QString qtError = QString("Execution Error: %1").arg(QString::fromStdString(e.what()));
-            outputWidget->append(qtError);
-        }
+        report(EngineSink::Kind::Error, message("Execution Error: ", e.what()));
 
         throw std::runtime_error(std::string("Script execution error: ") + e.what());
     }
 }
 
-void PythonEngine::captureAndDisplayPythonOutput() {
-    if (!initialized || !outputWidget) return;
-
-    try {
-        // Get captured output from Python
-        pybind11::object capture_result = pybind11::eval("_qt_output_capture.get_and_clear_output()", main_module.attr("__dict__"));
-        std::string captured_text = capture_result.cast<std::string>();
-
-        if (!captured_text.empty()) {
-            // Convert to QString
-            QString qtText = QString::fromStdString(captured_text);
-
-            // Remove any trailing newline to avoid double spacing when using append()
-            if (qtText.endsWith('\n')) {
-                qtText.chop(1);
-            }
+void PythonEngine::drainOutput(bool flushPartialLine) {
+    std::lock_guard<std::mutex> lock(outputMutex);
 
-            // Split by lines and append each one - this ensures proper formatting
-            QStringList lines = qtText.split('\n');
-            for (const QString& line : lines) {
-                outputWidget->append(line);
-            }
+    // A flush empties the ring; periodic drains stay within the budget
+    while (outputRing->read(pendingOutput, kMaxDrainBytes) == kMaxDrainBytes && flushPartialLine) {
+    }
+    size_t dropped = outputRing->takeDroppedBytes();
 
-            outputWidget->ensureCursorVisible();
-        }
+    // Only whole lines are forwarded so a line written in pieces is not split
+    size_t end = pendingOutput.rfind('\n');
+    end = (end == std::string::npos) ? 0 : end + 1;
+    if (flushPartialLine || pendingOutput.size() - end > kMaxPendingLine) {
+        end = pendingOutput.size();
+    }
 
-    } catch (const std::exception& e) {
-        // Fallback: if we can't capture Python output, at least show this error in Qt
-        if (outputWidget) {
-            outputWidget->append(QString("Error capturing Python output: %1").arg(e.what()));
+    if (end > 0) {
+        size_t length = (pendingOutput[end - 1] == '\n') ? end - 1 : end;
+        // One write per drain, however many lines it holds
+        if (sink) {
+            sink->write(EngineSink::Kind::Output, std::string_view(pendingOutput.data(), length));
         }
+        pendingOutput.erase(0, end);
+    }
+    if (dropped > 0 && sink) {
+        sink->write(EngineSink::Kind::Warning, message("[output truncated: ", dropped, " bytes dropped]"));
     }
 }
 
 std::vector<double> PythonEngine::getArray(const std::string& varName) {
     if (!initialized) {
-        if (outputWidget) {
-            outputWidget->append(QString("Warning: Python engine not initialized when trying to get array '%1'").arg(QString::fromStdString(varName)));
-        }
+        report(EngineSink::Kind::Warning, "Warning: Python engine not initialized when trying to get array '" + varName + "'");
         return std::vector<double>();
     }
+    pybind11::gil_scoped_acquire gil;
 
     try {
-        if (!main_module.attr("__dict__").contains(varName.c_str())) {
-            if (outputWidget) {
-                outputWidget->append(QString("Warning: Variable '%1' not found in Python namespace").arg(QString::fromStdString(varName)));
-            }
+        pybind11::dict ns = resultNamespace();
+        if (!ns.contains(varName.c_str())) {
+            report(EngineSink::Kind::Warning, "Warning: Variable '" + varName + "' not found in Python namespace");
             return std::vector<double>();
         }
 
-        auto pyArray = main_module.attr(varName.c_str());
+        auto pyArray = ns[varName.c_str()];
         auto result = pyArray.cast<std::vector<double>>();
 
-        if (outputWidget) {
-            outputWidget->append(QString("Retrieved array '%1' with %2 elements").arg(QString::fromStdString(varName)).arg(result.size()));
-        }
+        report(EngineSink::Kind::Info, message("Retrieved array '", varName, "' with ", result.size(), " elements"));
 
         return result;
 
     } catch (const pybind11::cast_error& e) {
-        if (outputWidget) {
-            outputWidget->append(QString("Cast Error: Cannot convert '%1' to vector<double>: %2").arg(QString::fromStdString(varName)).arg(e.what()));
-        }
+        report(EngineSink::Kind::Error, message("Cast Error: Cannot convert '", varName, "' to vector<double>: ", e.what()));
         return std::vector<double>();
     } catch (const std::exception& e) {
-        if (outputWidget) {
-            outputWidget->append(QString("Error retrieving array '%1': %2").arg(QString::fromStdString(varName)).arg(e.what()));
-        }
+        report(EngineSink::Kind::Error, message("Error retrieving array '", varName, "': ", e.what()));
         return std::vector<double>();
     }
 }
 
 double PythonEngine::getScalar(const std::string& varName) {
     if (!initialized) {
-        if (outputWidget) {
-            outputWidget->append(QString("Warning: Python engine not initialized when trying to get scalar '%1'").arg(QString::fromStdString(varName)));
-        }
+        report(EngineSink::Kind::Warning, "Warning: Python engine not initialized when trying to get scalar '" + varName + "'");
         return 0.0;
     }
+    pybind11::gil_scoped_acquire gil;
 
     try {
-        if (!main_module.attr("__dict__").contains(varName.c_str())) {
-            if (outputWidget) {
-                outputWidget->append(QString("Warning: Variable '%1' not found in Python namespace").arg(QString::fromStdString(varName)));
-            }
+        pybind11::dict ns = resultNamespace();
+        if (!ns.contains(varName.c_str())) {
+            report(EngineSink::Kind::Warning, "Warning: Variable '" + varName + "' not found in Python namespace");
             return 0.0;
         }
 
-        auto result = main_module.attr(varName.c_str()).cast<double>();
+        auto result = ns[varName.c_str()].cast<double>();
 
-        if (outputWidget) {
-            outputWidget->append(QString("Retrieved scalar '%1' = %2").arg(QString::fromStdString(varName)).arg(result));
-        }
+        report(EngineSink::Kind::Info, message("Retrieved scalar '", varName, "' = ", result));
 
         return result;
 
     } catch (const pybind11::cast_error& e) {
-        if (outputWidget) {
-            outputWidget->append(QString("Cast Error: Cannot convert '%1' to double: %2").arg(QString::fromStdString(varName)).arg(e.what()));
-        }
+        report(EngineSink::Kind::Error, message("Cast Error: Cannot convert '", varName, "' to double: ", e.what()));
         return 0.0;
     } catch (const std::exception& e) {
-        if (outputWidget) {
-            outputWidget->append(QString("Error retrieving scalar '%1': %2").arg(QString::fromStdString(varName)).arg(e.what()));
-        }
+        report(EngineSink::Kind::Error, message("Error retrieving scalar '", varName, "': ", e.what()));
         return 0.0;
     }
 }
 
 void PythonEngine::clearPreviousResults() {
     if (!initialized) return;
+    pybind11::gil_scoped_acquire gil;
 
     try {
         std::vector<std::string> vars_to_clear = {
             "fit_x", "fit_y", "amplitude", "frequency", "phase",
-            "residuals", "r_squared", "fitted_params"
+            "residuals", "r_squared", "fitted_params", "result"
         };
 
+        pybind11::dict ns = resultNamespace();
         for (const auto& var : vars_to_clear) {
-            if (main_module.attr("__dict__").contains(var.c_str())) {
-                pybind11::exec(var + " = None", main_module.attr("__dict__"));
+            if (ns.contains(var.c_str())) {
+                ns[var.c_str()] = pybind11::none();
             }
         }
 
     } catch (const std::exception& e) {
-        if (outputWidget) {
-            outputWidget->append(QString("Note: Could not clear all previous results: %1").arg(e.what()));
-        }
+        report(EngineSink::Kind::Warning, message("Note: Could not clear all previous results: ", e.what()));
     }
 }
 
@@ -444,23 +786,349 @@ std::vector<std::string> PythonEngine::getAvailableVariables() {
     std::vector<std::string> variables;
 
     if (!initialized) return variables;
+    pybind11::gil_scoped_acquire gil;
+
+    try {
+        for (auto item : resultNamespace()) {
+            auto name = item.first.cast<std::string>();
+            if (!name.empty() && name[0] != '_' && !PyCallable_Check(item.second.ptr())) {
+                variables.push_back(name);
+            }
+        }
+
+    } catch (const std::exception& e) {
+        report(EngineSink::Kind::Error, message("Error getting available variables: ", e.what()));
+    }
+
+    return variables;
+}
+
+void PythonEngine::setNamespaceMode(NamespaceMode mode) {
+    if (nsMode == mode) return;
+    nsMode = mode;
+    // Never carry a session namespace over into per-run mode or vice versa
+    releaseRunNamespace();
+}
+
+PythonEngine::NamespaceMode PythonEngine::namespaceMode() const {
+    return nsMode;
+}
+
+void PythonEngine::resetSession() {
+    releaseRunNamespace();
+}
+
+void PythonEngine::releaseRunNamespace() {
+    if (!initialized || !runNamespace) return;
+    pybind11::gil_scoped_acquire gil;
+
+    // Clearing first breaks the dict <-> function.__globals__ cycles, so the
+    // arrays are freed now rather than at the next garbage collection
+    runNamespace.attr("clear")();
+    runNamespace = pybind11::object();
+    lastRetainedBytes = 0;
+}
+
+size_t PythonEngine::retainedBytes() const {
+    return lastRetainedBytes;
+}
+
+void PythonEngine::setProfileMode(ProfileMode mode) {
+    profiling = mode;
+    if (mode == ProfileMode::Off) {
+        profile.functions.clear();
+        profile.lines.clear();
+    }
+}
+
+PythonEngine::ProfileMode PythonEngine::profileMode() const {
+    return profiling;
+}
+
+const PythonEngine::ProfileReport& PythonEngine::lastProfile() const {
+    return profile;
+}
+
+void PythonEngine::setMemoryLimits(const MemoryLimits& limits) {
+    this->limits = limits;
+}
+
+const PythonEngine::MemoryLimits& PythonEngine::memoryLimits() const {
+    return limits;
+}
+
+const PythonEngine::MemoryReport& PythonEngine::lastMemoryReport() const {
+    return memory;
+}
+
+void PythonEngine::startMemoryWatch() {
+    scriptThread = PyThread_get_thread_ident();
+    ownsTracing = false;
+    if (limits.traceAllocations) {
+        try {
+            ownsTracing = main_module.attr("_memory_trace_start")(1).cast<bool>();
+        } catch (const std::exception& e) {
+            report(EngineSink::Kind::Warning, message("Note: Could not start allocation tracing: ", e.what()));
+        }
+    }
+
+    MemoryWatchdog::Limits watch;
+    watch.softBytes = limits.softBytes;
+    watch.hardBytes = limits.hardBytes;
+    // Both run on the watchdog thread; the script thread gives up the GIL
+    // at its next switch interval
+    bool trace = limits.traceAllocations;
+    watchdog.start(watch,
+        [this, trace](size_t) {
+            if (!trace) return;
+            pybind11::gil_scoped_acquire gil;
+            memory.topSites = topAllocationSites();
+        },
+        [this](size_t) {
+            pybind11::gil_scoped_acquire gil;
+            PyThreadState_SetAsyncExc(scriptThread, PyExc_MemoryError);
+        });
+}
+
+void PythonEngine::finishMemoryWatch() {
+    // Keeps a failed run's exception intact while Python is called below
+    pybind11::error_scope pending;
 
+    MemoryWatchdog::Usage usage;
+    {
+        // The watchdog's callbacks need the GIL to finish
+        pybind11::gil_scoped_release release;
+        usage = watchdog.stop();
+    }
+    // A cancellation that arrived after the last bytecode must not hit the host
+    PyThreadState_SetAsyncExc(scriptThread, nullptr);
+
+    memory.rssStart = usage.start;
+    memory.rssPeak = usage.peak;
+    memory.rssEnd = usage.end;
+    memory.softExceeded = usage.softExceeded;
+    memory.hardExceeded = usage.hardExceeded;
+
+    if (limits.traceAllocations) {
+        try {
+            // Sites captured at the soft limit show the peak better than what is left now
+            if (memory.topSites.empty()) {
+                memory.topSites = topAllocationSites();
+            }
+            memory.tracedPeak = main_module.attr("_memory_trace_stop")(ownsTracing).cast<size_t>();
+        } catch (const std::exception& e) {
+            report(EngineSink::Kind::Warning, message("Note: Could not read allocation tracing: ", e.what()));
+        }
+    }
+}
+
+std::vector<std::string> PythonEngine::topAllocationSites() {
+    std::vector<std::string> sites;
     try {
-        pybind11::exec(R"(
-_available_vars = []
-for name, obj in globals().items():
-    if not name.startswith('_') and not callable(obj):
-        _available_vars.append(name)
-)", main_module.attr("__dict__"));
+        auto stats = main_module.attr("_memory_top_sites")(kTopAllocationSites);
+        for (auto stat : stats) {
+            auto [location, bytes, blocks] = stat.cast<std::tuple<std::string, size_t, size_t>>();
+            sites.push_back(message(location, ": ", std::fixed, std::setprecision(2), bytes / (1024.0 * 1024.0),
+                                    " MB in ", blocks, " blocks"));
+        }
+    } catch (const std::exception&) {
+        // Best effort: a snapshot can fail under memory pressure
+    }
+    return sites;
+}
+
+void PythonEngine::reportMemory() {
+    // Nothing measured, e.g. the script did not compile
+    if (memory.rssPeak == 0) return;
+
+    auto megabytes = [](size_t bytes) { return message(std::fixed, std::setprecision(1), bytes / (1024.0 * 1024.0), " MB"); };
+    size_t peakGrowth = memory.rssPeak > memory.rssStart ? memory.rssPeak - memory.rssStart : 0;
+    long long netGrowth = static_cast<long long>(memory.rssEnd) - static_cast<long long>(memory.rssStart);
+
+    std::string summary = message("Memory: peak +", megabytes(peakGrowth), " RSS (", megabytes(memory.rssPeak),
+                                  "), ", netGrowth >= 0 ? "+" : "-",
+                                  megabytes(static_cast<size_t>(netGrowth >= 0 ? netGrowth : -netGrowth)),
+                                  " after the run");
+    if (limits.traceAllocations) {
+        summary += message(", Python peak ", megabytes(memory.tracedPeak));
+    }
+    report(EngineSink::Kind::Info, summary);
+
+    if (memory.hardExceeded) {
+        report(EngineSink::Kind::Error, message("Run cancelled: memory grew past the hard limit of ",
+                                                megabytes(limits.hardBytes)));
+    } else if (memory.softExceeded) {
+        report(EngineSink::Kind::Warning, message("Memory grew past the soft limit of ", megabytes(limits.softBytes)));
+    }
 
-        auto py_vars = main_module.attr("_available_vars");
-        variables = py_vars.cast<std::vector<std::string>>();
+    if (!memory.topSites.empty() && (memory.softExceeded || memory.hardExceeded || limits.traceAllocations)) {
+        std::string sites = memory.softExceeded ? "Top allocation sites at the soft limit:"
+                                                : "Top allocation sites still live:";
+        for (const auto& site : memory.topSites) {
+            sites += "\n  " + site;
+        }
+        report(memory.softExceeded ? EngineSink::Kind::Warning : EngineSink::Kind::Info, sites);
+    } else if ((memory.softExceeded || memory.hardExceeded) && !limits.traceAllocations) {
+        report(EngineSink::Kind::Info, "Enable allocation tracing to see where the memory was allocated");
+    }
+}
+
+pybind11::dict PythonEngine::prepareRunNamespace() {
+    if (nsMode == NamespaceMode::Session && runNamespace) {
+        clearPreviousResults();
+    } else {
+        releaseRunNamespace();
+        runNamespace = main_module.attr("_new_run_namespace")();
+    }
+
+    auto ns = pybind11::reinterpret_borrow<pybind11::dict>(runNamespace);
+    if (dataX && dataY) {
+        // Read-only, so a script cannot sort or overwrite the buffers in place
+        if (!dataXView || viewVersion != dataVersion) {
+            dataXView = readOnlyView(dataX, dataSize);
+            dataYView = readOnlyView(dataY, dataSize);
+            viewVersion = dataVersion;
+        }
+        ns["x_data"] = dataXView;
+        ns["y_data"] = dataYView;
+        ns["data_size"] = pybind11::cast(dataSize);
+        ns["data_generation"] = pybind11::cast(dataVersion);
+        ns["data_new_from"] = pybind11::cast(seenReplacedAt == replacedAt ? std::min(seenSize, dataSize) : size_t{0});
+        seenReplacedAt = replacedAt;
+        seenSize = dataSize;
+    }
+    return ns;
+}
+
+pybind11::dict PythonEngine::resultNamespace() {
+    if (runNamespace) {
+        return pybind11::reinterpret_borrow<pybind11::dict>(runNamespace);
+    }
+    return main_module.attr("__dict__").cast<pybind11::dict>();
+}
+
+void PythonEngine::reportRetainedMemory() {
+    if (!runNamespace) return;
+
+    try {
+        auto usage = main_module.attr("_namespace_retained_bytes")(runNamespace).cast<std::pair<size_t, size_t>>();
+        lastRetainedBytes = usage.second;
 
+        report(EngineSink::Kind::Info,
+               message(nsMode == NamespaceMode::Session ? "Session" : "Run", " namespace retains ", usage.first,
+                       " objects (", std::fixed, std::setprecision(2), usage.second / (1024.0 * 1024.0), " MB)"));
     } catch (const std::exception& e) {
-        if (outputWidget) {
-            outputWidget->append(QString("Error getting available variables: %1").arg(e.what()));
+        report(EngineSink::Kind::Warning, message("Note: Could not measure namespace memory: ", e.what()));
+    }
+}
+
+CppSineFitter::FitResult PythonEngine::getFitResult() {
+    if (!initialized) {
+        throw std::runtime_error("Python engine not initialized");
+    }
+    pybind11::gil_scoped_acquire gil;
+    auto marshal_start = std::chrono::high_resolution_clock::now();
+
+    CppSineFitter::FitResult result = {};
+    result.fit_time = lastExecTime;
+
+    pybind11::dict ns = resultNamespace();
+    pybind11::object mapping = main_module.attr("_result_mapping")(ns);
+    bool structured = !mapping.is_none();
+    pybind11::dict source = structured ? mapping.cast<pybind11::dict>() : ns;
+
+    std::vector<std::string> problems;
+    for (const auto& field : ScriptResultSchema::fields()) {
+        if (!source.contains(field.name) || source[field.name].is_none()) {
+            if (field.required) {
+                problems.push_back(std::string("missing '") + field.name + "'");
+            }
+            continue;
+        }
+
+        pybind11::object value = source[field.name];
+        try {
+            if (field.array) {
+                result.*field.array = toDoubleVector(value);
+            } else if (field.scalar) {
+                result.*field.scalar = value.cast<double>();
+            } else if (field.params) {
+                auto values = toDoubleVector(value);
+                if (values.size() != 4) {
+                    problems.push_back(std::string("'") + field.name + "' must have 4 elements");
+                    continue;
+                }
+                std::copy(values.begin(), values.end(), (result.*field.params).begin());
+            }
+        } catch (const pybind11::cast_error&) {
+            problems.push_back(std::string("'") + field.name + "' has type " +
+                               std::string(pybind11::str(pybind11::type::handle_of(value).attr("__name__"))));
         }
     }
 
-    return variables;
-}
\ No newline at end of file
+    if (problems.empty() && result.fit_x.size() != result.fit_y.size()) {
+        problems.push_back("fit_x and fit_y differ in length");
+    }
+    if (problems.empty() && result.fit_x.empty()) {
+        problems.push_back("fit_x is empty");
+    }
+
+    if (!problems.empty()) {
+        throw std::runtime_error(ScriptResultSchema::invalidMessage(problems));
+    }
+
+    profile.marshalOut = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - marshal_start);
+
+    report(EngineSink::Kind::Info,
+           message("Retrieved ", structured ? "structured" : "legacy", " result (", result.fit_x.size(), " fit points)"));
+
+    return result;
+}
+
+void PythonEngine::setWorkerCount(size_t count) {
+    if (count == workerCount) return;
+    workerCount = count;
+    workerPool.reset();
+}
+
+void PythonEngine::setWorkerDaemon(const std::string& socketPath) {
+    if (socketPath == workerDaemonSocket) return;
+    workerDaemonSocket = socketPath;
+    workerPool.reset();
+}
+
+std::vector<PythonWorkerPool::JobResult> PythonEngine::map(const std::string& script,
+                                                           const std::vector<PythonWorkerPool::Trace>& traces) {
+    if (!workerPool) {
+        if (workerDaemonSocket.empty()) {
+            workerPool = std::make_unique<PythonWorkerPool>(workerCount);
+        } else {
+            PythonWorkerPool::DaemonOptions options;
+            options.socketPath = workerDaemonSocket;
+            options.workers = workerCount;
+            workerPool = std::make_unique<PythonWorkerPool>(options);
+        }
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    auto results = workerPool->map(script, traces);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start_time);
+
+    // Worker output arrives whole, after its job; shown in trace order
+    for (size_t i = 0; i < results.size(); ++i) {
+        std::string_view output = results[i].output;
+        while (!output.empty() && output.back() == '\n') output.remove_suffix(1);
+        if (output.empty()) continue;
+        if (results.size() > 1) report(EngineSink::Kind::Info, message("Trace ", i, " output:"));
+        report(EngineSink::Kind::Output, std::string(output));
+    }
+
+    size_t failed = std::count_if(results.begin(), results.end(),
+                                  [](const PythonWorkerPool::JobResult& r) { return !r.ok; });
+    report(EngineSink::Kind::Info, message("Worker run: ", traces.size(), " traces on ", workerPool->workerCount(),
+                                           " workers in ", elapsed.count(), " ms (", failed, " failed)"));
+
+    return results;
+}
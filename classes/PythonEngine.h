@@ -2,21 +2,121 @@
 
 #include <pybind11/embed.h>
 #include <pybind11/stl.h>
-#include <QtWidgets/QTextEdit>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <vector>
 #include <string>
+#include <thread>
+#include <chrono>
+#include "CppSineFitter.h"
+#include "DataSet.h"
+#include "PythonWorkerPool.h"
+#include "OutputRingBuffer.h"
+#include "EngineSink.h"
+#include "PythonProfiler.h"
+#include "MemoryWatchdog.h"
 
 class PythonEngine {
 public:
+    enum class NamespaceMode {
+        PerRun,   // every executeScript() starts from a fresh namespace
+        Session   // runs share one namespace until resetSession()
+    };
+
+    // What syncData() had to send
+    enum class DataSync {
+        Unchanged,
+        Appended,
+        Replaced
+    };
+
+    enum class ProfileMode {
+        Off,
+        Functions,  // per-function timing, builtins included
+        Lines       // also per-line timing of the script itself
+    };
+
+    // Timing of the last setData/executeScript/getFitResult sequence. Phases
+    // are always measured; functions and lines only when profiling is on.
+    struct ProfileReport {
+        std::chrono::microseconds marshalIn{0};   // setData/syncData: C++ vectors to Python
+        std::chrono::microseconds compile{0};
+        std::chrono::microseconds execute{0};
+        std::chrono::microseconds marshalOut{0};  // getFitResult: Python to C++
+        std::vector<PythonProfiler::FunctionStats> functions;
+        std::vector<PythonProfiler::LineStats> lines;
+    };
+
+    // Per-run memory limits, as growth of the process RSS over the start of
+    // executeScript. Crossing the soft limit reports the top allocation sites;
+    // crossing the hard limit cancels the run by raising MemoryError in it
+    // (delivered at the next bytecode, so a single huge C allocation can
+    // still overshoot).
+    struct MemoryLimits {
+        size_t softBytes = 0;           // 0 disables
+        size_t hardBytes = 0;
+        bool traceAllocations = false;  // tracemalloc: Python peak and sites; slows allocation-heavy code
+    };
+
+    struct MemoryReport {
+        size_t rssStart = 0;
+        size_t rssPeak = 0;
+        size_t rssEnd = 0;
+        size_t tracedPeak = 0;  // traced Python allocations, NumPy buffers included
+        bool softExceeded = false;
+        bool hardExceeded = false;
+        std::vector<std::string> topSites;  // "file:line: size in blocks", largest first
+    };
+
     PythonEngine();
     ~PythonEngine();
 
-    void setOutputWidget(QTextEdit* outputWidget);
+    // Receives script output and engine diagnostics; without one they are
+    // discarded. The engine holds no GUI of its own.
+    void setSink(std::shared_ptr<EngineSink> sink);
+
+    // Python stdout/stderr stream into a bounded ring that the host drains
+    // with drainOutput(). The capacity is fixed once initialized.
+    void setOutputCapacity(size_t bytes);
+    void setOutputBackpressure(OutputRingBuffer::Backpressure policy);
+    // Discards script and engine output, e.g. so benchmarks time no logging
+    void setOutputMuted(bool muted);
+
+    // Forwards complete lines from the ring to the sink. Any thread, never
+    // takes the GIL; flushPartialLine also emits an unterminated tail.
+    // executeScript drains on completion, so headless callers need not.
+    void drainOutput(bool flushPartialLine = false);
+
+    // Minimal core start-up: interpreter, output capture and cached sys.path
     void initialize();
     bool isInitialized() const;
 
-    void setData(const std::vector<double>& x_data, const std::vector<double>& y_data);
+    // Initialize now and import heavy modules on a background thread so the
+    // first analysis does not pay for them
+    void prewarm(const std::vector<std::string>& modules = {"numpy"});
+
+    // Verbose path discovery and module version report; refreshes the path cache
+    void runDiagnostics();
+
+    static std::string pathCacheFile();
+
+    // setData, executeScript and getFitResult are safe to call from a worker
+    // thread once initialized; what they report reaches the sink in order
+    // behind the script's own output
+    void setData(std::span<const double> x_data, std::span<const double> y_data);
+    // Versioned upload. `generation` names the caller's dataset: it changes
+    // when the data is replaced and stays when samples are only appended.
+    // An unchanged dataset is not sent again and an appended one only extends
+    // the engine's copy. Scripts get read-only float64 memoryviews of it. Runs also see
+    // data_generation and data_new_from, the first sample the previous run
+    // did not see (0 after a replacement).
+    DataSync syncData(std::span<const double> x_data, std::span<const double> y_data, uint64_t generation);
+    DataSync syncData(const DataSet& data);
+    // Bumped by every upload or append that reaches Python
+    uint64_t dataGeneration() const;
     void executeScript(const std::string& script);
 
     std::vector<double> getArray(const std::string& varName);
@@ -24,13 +124,93 @@ public:
 
     std::vector<std::string> getAvailableVariables();
 
+    // Reads all fit outputs of the last run in one pass, validated against the
+    // result schema. Scripts publish a `result` dict/dataclass; without one the
+    // legacy globals (fit_x, fit_y, amplitude, ...) are used. Throws on invalid results.
+    CppSineFitter::FitResult getFitResult();
+
+    // Batch mode: runs `script` over every trace in parallel worker processes
+    // (independent of the embedded interpreter) and gathers results in order
+    std::vector<PythonWorkerPool::JobResult> map(const std::string& script,
+                                                 const std::vector<PythonWorkerPool::Trace>& traces);
+    void setWorkerCount(size_t count);
+    // Borrows warm workers from a shared daemon on this Unix socket (started
+    // on first use) instead of owning worker processes; empty turns it off
+    void setWorkerDaemon(const std::string& socketPath);
+
+    // Namespace lifetime: the last run's namespace stays alive (so results can
+    // be read) until the next per-run execution or an explicit release
+    void setNamespaceMode(NamespaceMode mode);
+    NamespaceMode namespaceMode() const;
+    void resetSession();
+    void releaseRunNamespace();
+    size_t retainedBytes() const;
+
+    void setProfileMode(ProfileMode mode);
+    ProfileMode profileMode() const;
+    const ProfileReport& lastProfile() const;
+
+    void setMemoryLimits(const MemoryLimits& limits);
+    const MemoryLimits& memoryLimits() const;
+    const MemoryReport& lastMemoryReport() const;
+
 private:
+    pybind11::dict prepareRunNamespace();
+    pybind11::dict resultNamespace();
+    void reportRetainedMemory();
+    void startMemoryWatch();
+    void finishMemoryWatch();
+    void reportMemory();
+    std::vector<std::string> topAllocationSites();
     void clearPreviousResults();
-    void captureAndDisplayPythonOutput();
+    void uploadData(std::span<const double> x_data, std::span<const double> y_data);
+    // Drains pending script output first so messages keep their place
+    void report(EngineSink::Kind kind, const std::string& text);
+
+    // Declared first so it outlives interpreter shutdown, which may still write
+    std::unique_ptr<OutputRingBuffer> outputRing;
+    std::string pendingOutput;  // drained text without its closing newline yet
+    std::mutex outputMutex;     // one drainer at a time; guards sink and pendingOutput
+    std::shared_ptr<EngineSink> sink;
+    std::atomic<bool> outputMuted{false};
 
     std::unique_ptr<pybind11::scoped_interpreter> guard;
+    // Held while no engine call is running so the warm-up thread can take the GIL
+    std::unique_ptr<pybind11::gil_scoped_release> gilRelease;
+    std::thread warmupThread;
     pybind11::module_ main_module;
     bool initialized = false;
 
-    QTextEdit* outputWidget = nullptr;
+    // Python objects stay null until the interpreter is up
+    pybind11::object runNamespace;
+    // float64 samples in bytearrays with room past dataSize for appends
+    pybind11::object dataX;
+    pybind11::object dataY;
+    // Views of dataX/dataY handed to scripts, rebuilt when dataVersion moves
+    pybind11::object dataXView;
+    pybind11::object dataYView;
+    uint64_t viewVersion = 0;
+    size_t dataSize = 0;
+    uint64_t dataVersion = 0;         // data_generation as seen by scripts
+    uint64_t replacedAt = 0;          // dataVersion at the last full upload
+    std::optional<uint64_t> source;   // caller's generation of the mirrored data
+    uint64_t seenReplacedAt = 0;      // what the previous run saw, for data_new_from
+    size_t seenSize = 0;
+    NamespaceMode nsMode = NamespaceMode::PerRun;
+    size_t lastRetainedBytes = 0;
+    std::chrono::microseconds lastExecTime{0};
+
+    ProfileMode profiling = ProfileMode::Off;
+    ProfileReport profile;
+    std::unique_ptr<PythonProfiler> profiler;
+
+    MemoryLimits limits;
+    MemoryReport memory;
+    MemoryWatchdog watchdog;
+    unsigned long scriptThread = 0;  // Python thread id of the running script
+    bool ownsTracing = false;        // tracemalloc was started by the engine
+
+    std::unique_ptr<PythonWorkerPool> workerPool;
+    size_t workerCount = 0;
+    std::string workerDaemonSocket;
 };
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "PythonProfiler.h"
+#include <algorithm>
+#include <frameobject.h>
+
+namespace {
+
+std::string unicodeToString(PyObject* text) {
+    if (!text || !PyUnicode_Check(text)) return {};
+    Py_ssize_t size = 0;
+    const char* utf8 = PyUnicode_AsUTF8AndSize(text, &size);
+    if (!utf8) {
+        PyErr_Clear();
+        return {};
+    }
+    return std::string(utf8, static_cast<size_t>(size));
+}
+
+}
+
+PythonProfiler::~PythonProfiler() {
+    if (active) stop();
+}
+
+void PythonProfiler::start(bool lines, const std::string& scriptFile) {
+    if (active) stop();
+
+    this->scriptFile = scriptFile;
+    tracing = lines;
+    active = true;
+    hookArg = pybind11::capsule(this);
+
+    PyEval_SetProfile(&PythonProfiler::profileHook, hookArg.ptr());
+    if (tracing) {
+        PyEval_SetTrace(&PythonProfiler::traceHook, hookArg.ptr());
+    }
+}
+
+void PythonProfiler::stop() {
+    if (!active) return;
+
+    PyEval_SetProfile(nullptr, nullptr);
+    if (tracing) {
+        PyEval_SetTrace(nullptr, nullptr);
+    }
+    // Frames still open (e.g. stopped from inside a call) end now
+    auto now = Clock::now();
+    while (!stack.empty()) {
+        leave(now);
+    }
+    hookArg = pybind11::object();
+    active = false;
+}
+
+void PythonProfiler::clear() {
+    if (active) stop();
+    entries.clear();
+    lineStats.clear();
+}
+
+int PythonProfiler::profileHook(PyObject* self, PyFrameObject* frame, int what, PyObject* arg) {
+    auto* profiler = static_cast<PythonProfiler*>(PyCapsule_GetPointer(self, nullptr));
+    auto now = Clock::now();
+
+    switch (what) {
+    case PyTrace_CALL: {
+        PyCodeObject* code = PyFrame_GetCode(frame);
+        Entry& entry = profiler->entryFor(reinterpret_cast<PyObject*>(code), false);
+        Py_DECREF(code);
+        profiler->enter(entry, now);
+        break;
+    }
+    case PyTrace_C_CALL:
+        profiler->enter(profiler->entryFor(arg, true), now);
+        break;
+    case PyTrace_RETURN:
+    case PyTrace_C_RETURN:
+    case PyTrace_C_EXCEPTION:
+        profiler->leave(now);
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+int PythonProfiler::traceHook(PyObject* self, PyFrameObject* frame, int what, PyObject*) {
+    // Calls and returns come from the profile hook; only lines are handled here
+    if (what != PyTrace_LINE) return 0;
+
+    auto* profiler = static_cast<PythonProfiler*>(PyCapsule_GetPointer(self, nullptr));
+    if (profiler->stack.empty()) return 0;
+
+    Frame& top = profiler->stack.back();
+    if (!top.entry->script) return 0;
+
+    auto now = Clock::now();
+    profiler->flushLine(top, now);
+    top.line = PyFrame_GetLineNumber(frame);
+    top.lineStart = now;
+    return 0;
+}
+
+PythonProfiler::Entry& PythonProfiler::entryFor(PyObject* key, bool native) {
+    // Bound builtins are fresh objects per call (s.rstrip), so they are keyed
+    // by their method table entry; code objects are kept alive instead
+    const void* id = key;
+    if (native) {
+        id = PyCFunction_Check(key) ? static_cast<const void*>(reinterpret_cast<PyCFunctionObject*>(key)->m_ml)
+                                    : static_cast<const void*>(Py_TYPE(key));
+    }
+    auto it = entries.find(id);
+    if (it != entries.end()) return it->second;
+
+    Entry entry;
+    if (!native) {
+        entry.key = pybind11::reinterpret_borrow<pybind11::object>(key);
+    }
+    entry.stats.native = native;
+
+    // Names come straight from the object structs: no attribute lookups, so
+    // nothing can run Python code or disturb a pending exception
+    if (!native) {
+        auto* code = reinterpret_cast<PyCodeObject*>(key);
+#if PY_VERSION_HEX >= 0x030B0000
+        entry.stats.name = unicodeToString(code->co_qualname);
+#else
+        entry.stats.name = unicodeToString(code->co_name);
+#endif
+        std::string file = unicodeToString(code->co_filename);
+        entry.stats.location = file + ":" + std::to_string(code->co_firstlineno);
+        entry.script = (file == scriptFile);
+    } else if (PyCFunction_Check(key)) {
+        auto* function = reinterpret_cast<PyCFunctionObject*>(key);
+        entry.stats.name = function->m_ml->ml_name;
+        PyObject* owner = function->m_self;
+        if (owner && PyModule_Check(owner)) {
+            if (const char* module = PyModule_GetName(owner)) {
+                entry.stats.location = module;
+            } else {
+                PyErr_Clear();
+            }
+        } else if (owner) {
+            entry.stats.location = Py_TYPE(owner)->tp_name;
+        }
+    } else {
+        entry.stats.name = Py_TYPE(key)->tp_name;
+    }
+    if (entry.stats.location.empty()) {
+        entry.stats.location = "<builtin>";
+    }
+
+    return entries.emplace(id, std::move(entry)).first->second;
+}
+
+void PythonProfiler::enter(Entry& entry, Clock::time_point now) {
+    ++entry.depth;
+    stack.push_back({&entry, now});
+}
+
+void PythonProfiler::leave(Clock::time_point now) {
+    // Returns of frames entered before start() have nothing to close
+    if (stack.empty()) return;
+
+    Frame frame = stack.back();
+    stack.pop_back();
+    if (tracing) {
+        flushLine(frame, now);
+    }
+
+    auto elapsed = now - frame.start;
+    Entry& entry = *frame.entry;
+    ++entry.stats.calls;
+    entry.stats.self += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed - frame.children);
+    if (--entry.depth == 0) {
+        entry.stats.total += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+    }
+
+    if (!stack.empty()) {
+        stack.back().children += elapsed;
+    }
+}
+
+void PythonProfiler::flushLine(Frame& frame, Clock::time_point now) {
+    if (frame.line < 0) return;
+
+    LineStats& stats = lineStats[frame.line];
+    stats.line = frame.line;
+    ++stats.hits;
+    stats.time += std::chrono::duration_cast<std::chrono::nanoseconds>(now - frame.lineStart);
+    frame.line = -1;
+}
+
+std::vector<PythonProfiler::FunctionStats> PythonProfiler::functions() const {
+    std::vector<FunctionStats> result;
+    result.reserve(entries.size());
+    for (const auto& [key, entry] : entries) {
+        if (entry.stats.calls > 0) {
+            result.push_back(entry.stats);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const FunctionStats& a, const FunctionStats& b) {
+        return a.self > b.self;
+    });
+    return result;
+}
+
+std::vector<PythonProfiler::LineStats> PythonProfiler::lines() const {
+    std::vector<LineStats> result;
+    result.reserve(lineStats.size());
+    for (const auto& [line, stats] : lineStats) {
+        result.push_back(stats);
+    }
+    std::sort(result.begin(), result.end(), [](const LineStats& a, const LineStats& b) {
+        return a.line < b.line;
+    });
+    return result;
+}
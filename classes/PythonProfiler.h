@@ -0,0 +1,77 @@
+// PythonProfiler.h - Low-overhead function and line timing for embedded Python code
+#pragma once
+#include <pybind11/pybind11.h>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Hooks the interpreter through the C-level PyEval_SetProfile/PyEval_SetTrace
+// callbacks, so no Python code runs per event. Function timing covers Python
+// functions and C builtins (NumPy calls show up by name); line timing is
+// restricted to code compiled from the profiled script.
+class PythonProfiler {
+public:
+    struct FunctionStats {
+        std::string name;
+        std::string location;  // file:line, or the owning module/type for builtins
+        size_t calls = 0;
+        std::chrono::nanoseconds total{0};  // including callees
+        std::chrono::nanoseconds self{0};
+        bool native = false;
+    };
+
+    struct LineStats {
+        int line = 0;
+        size_t hits = 0;
+        std::chrono::nanoseconds time{0};  // including calls made from the line
+    };
+
+    PythonProfiler() = default;
+    ~PythonProfiler();
+
+    PythonProfiler(const PythonProfiler&) = delete;
+    PythonProfiler& operator=(const PythonProfiler&) = delete;
+
+    // Both need the GIL and must be called on the thread that runs the code
+    void start(bool lines, const std::string& scriptFile);
+    void stop();
+    void clear();
+
+    std::vector<FunctionStats> functions() const;  // by self time, largest first
+    std::vector<LineStats> lines() const;          // by line number
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        pybind11::object key;  // keeps code objects alive so addresses stay unique
+        FunctionStats stats;
+        int depth = 0;         // recursion depth, so total is counted once
+        bool script = false;
+    };
+
+    struct Frame {
+        Entry* entry;
+        Clock::time_point start;
+        Clock::duration children{0};
+        int line = -1;
+        Clock::time_point lineStart;
+    };
+
+    static int profileHook(PyObject* self, PyFrameObject* frame, int what, PyObject* arg);
+    static int traceHook(PyObject* self, PyFrameObject* frame, int what, PyObject* arg);
+
+    Entry& entryFor(PyObject* key, bool native);
+    void enter(Entry& entry, Clock::time_point now);
+    void leave(Clock::time_point now);
+    void flushLine(Frame& frame, Clock::time_point now);
+
+    std::unordered_map<const void*, Entry> entries;
+    std::unordered_map<int, LineStats> lineStats;
+    std::vector<Frame> stack;
+    std::string scriptFile;
+    pybind11::object hookArg;
+    bool tracing = false;
+    bool active = false;
+};
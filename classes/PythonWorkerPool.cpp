@@ -0,0 +1,1052 @@
+#include "PythonWorkerPool.h"
+#include "ScriptResultSchema.h"
+#include "SharedMemorySegment.h"
+#include <stdexcept>
+#include <thread>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <map>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <csignal>
+#include <cerrno>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+#ifndef CPPPYTHON_PYTHON_EXECUTABLE
+#define CPPPYTHON_PYTHON_EXECUTABLE "python3"
+#endif
+
+namespace {
+
+// Job block layout inside the ring, in doubles:
+//   [0, n)                     x data
+//   [n, 2n)                    y data
+//   [2n, 2n + kHeaderDoubles)  scalars: amplitude, frequency, phase, offset,
+//                              r_squared, rmse, aic, param_errors[4], exec time (us)
+//   then fit_x[capacity], fit_y[capacity]
+constexpr size_t kHeaderDoubles = 16;
+constexpr size_t kMinResultCapacity = 1024;
+
+size_t resultCapacity(size_t n) {
+    return std::max(n, kMinResultCapacity);
+}
+
+size_t jobBlockBytes(size_t n) {
+    return (2 * n + kHeaderDoubles + 2 * resultCapacity(n)) * sizeof(double);
+}
+
+// Shared by both kinds of worker: the protocol handler for one control
+// connection. Every control message is a header line whose last field is the
+// length of the payload that follows it. Compiled scripts are cached by
+// content, so a long-lived worker compiles each script once.
+const char* kWorkerCore = R"(
+import sys
+import os
+import io
+import time
+import array
+import socket
+import hashlib
+import traceback
+from multiprocessing import shared_memory, resource_tracker
+
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
+HEADER_DOUBLES = 16
+SCALAR_FIELDS = ("amplitude", "frequency", "phase", "offset", "r_squared", "rmse", "aic")
+MAX_CACHED_SCRIPTS = 32
+MAX_CAPTURED_OUTPUT = 64 * 1024  # characters of a job's output sent back
+
+sys.stdin = io.StringIO()
+
+_ring = None
+_ring_view = None
+_scripts = {}
+
+def _reply(control, header, payload=b""):
+    control.sendall(f"{header} {len(payload)}\n".encode() + payload)
+
+def _detach_ring():
+    global _ring, _ring_view
+    if _ring is not None:
+        try:
+            _ring_view.release()
+            _ring.close()
+        except BufferError:
+            # Still referenced (e.g. from a traceback); unmapped when collected
+            pass
+    _ring = None
+    _ring_view = None
+
+def _attach_ring(name):
+    global _ring, _ring_view
+    _detach_ring()
+    _ring = shared_memory.SharedMemory(name=name)
+    # The app owns the segment; keep this process's tracker from unlinking it
+    resource_tracker.unregister(_ring._name, "shared_memory")
+    _ring_view = _ring.buf.cast("d")
+
+def _compile(source):
+    key = hashlib.sha1(source).hexdigest()
+    code = _scripts.pop(key, None)
+    if code is None:
+        code = compile(source.decode(), "<analysis>", "exec")
+    _scripts[key] = code
+    while len(_scripts) > MAX_CACHED_SCRIPTS:
+        del _scripts[next(iter(_scripts))]
+    return code
+
+class _TailOutput(io.TextIOBase):
+    """stdout/stderr of one job; keeps only the last MAX_CAPTURED_OUTPUT characters"""
+    def __init__(self):
+        self._parts = []
+        self._size = 0
+        self._dropped = False
+
+    def writable(self):
+        return True
+
+    def write(self, text):
+        self._parts.append(text)
+        self._size += len(text)
+        if self._size > 2 * MAX_CAPTURED_OUTPUT:
+            self._trim()
+        return len(text)
+
+    def _trim(self):
+        text = "".join(self._parts)
+        if len(text) > MAX_CAPTURED_OUTPUT:
+            text = text[-MAX_CAPTURED_OUTPUT:]
+            self._dropped = True
+        self._parts = [text]
+        self._size = len(text)
+
+    def getvalue(self):
+        self._trim()
+        text = self._parts[0]
+        if self._dropped:
+            # Start at a whole line
+            text = "[earlier output dropped]\n" + text[text.find("\n") + 1:]
+        return text
+
+def _doubles(values):
+    if np is not None:
+        return np.ascontiguousarray(values, dtype=np.float64)
+    return array.array("d", (float(v) for v in values))
+
+def _run(code, offset, n, capacity, output):
+    buf = _ring_view[offset:offset + 2 * n + HEADER_DOUBLES + 2 * capacity]
+    namespace = None
+    try:
+        # Read-only: the ring is shared with the host
+        if np is not None:
+            data = np.ndarray((2 * n,), dtype=np.float64, buffer=buf)
+            data.flags.writeable = False
+            x, y = data[:n], data[n:]
+        else:
+            x, y = buf[:n].toreadonly(), buf[n:2 * n].toreadonly()
+        namespace = {"__name__": "__main__", "x_data": x, "y_data": y, "data_size": n}
+
+        sys.stdout = sys.stderr = output
+        start = time.perf_counter()
+        exec(code, namespace)
+        elapsed_us = (time.perf_counter() - start) * 1e6
+
+        # Same contract as the embedded engine (ScriptResultSchema)
+        result = _result_source(namespace)
+        _require_result_fields(result)
+        fit_x, fit_y = _doubles(result["fit_x"]), _doubles(result["fit_y"])
+        if len(fit_x) != len(fit_y):
+            raise ValueError("fit_x and fit_y differ in length")
+        if len(fit_x) > capacity:
+            raise ValueError(f"fit result has {len(fit_x)} points, capacity is {capacity}")
+
+        header = [float("nan")] * HEADER_DOUBLES
+        for i, field in enumerate(SCALAR_FIELDS):
+            if result.get(field) is not None:
+                header[i] = float(result[field])
+        errors = result.get("param_errors")
+        if errors is not None and len(errors) == 4:
+            header[7:11] = [float(e) for e in errors]
+        header[11] = elapsed_us
+
+        base = 2 * n
+        buf[base:base + HEADER_DOUBLES] = array.array("d", header)
+        base += HEADER_DOUBLES
+        buf[base:base + len(fit_x)] = memoryview(fit_x).cast("B").cast("d")
+        base += capacity
+        buf[base:base + len(fit_y)] = memoryview(fit_y).cast("B").cast("d")
+        return len(fit_x)
+    finally:
+        sys.stdout = sys.stderr = sys.__stderr__
+        if namespace is not None:
+            namespace.clear()
+
+def _serve(control, on_message=None):
+    # Handles one client until it quits or disconnects
+    control_in = control.makefile("rb")
+    code = None
+    try:
+        while True:
+            header = control_in.readline()
+            if not header:
+                break
+            if on_message is not None:
+                on_message()
+            parts = header.decode().split()
+            payload = control_in.read(int(parts[-1])) if int(parts[-1]) else b""
+            op = parts[0]
+
+            if op == "attach":
+                try:
+                    _attach_ring(parts[1])
+                    _reply(control, "ready")
+                except Exception:
+                    _reply(control, "err -", traceback.format_exc().encode())
+            elif op == "script":
+                try:
+                    code = _compile(payload)
+                    _reply(control, "ready")
+                except Exception:
+                    code = None
+                    _reply(control, "err -", traceback.format_exc().encode())
+            elif op == "run":
+                job, offset, n, capacity = parts[1], int(parts[2]), int(parts[3]), int(parts[4])
+                # The script's output leads the payload; an error's traceback follows it
+                output = _TailOutput()
+                try:
+                    if code is None or _ring_view is None:
+                        raise RuntimeError("worker has no script or ring attached")
+                    points = _run(code, offset, n, capacity, output)
+                    text = output.getvalue().encode(errors="replace")
+                    _reply(control, f"ok {job} {points} {len(text)}", text)
+                except Exception:
+                    text = output.getvalue().encode(errors="replace")
+                    _reply(control, f"err {job} {len(text)}", text + traceback.format_exc().encode())
+            elif op == "quit":
+                break
+    finally:
+        # The client's segment must not stay mapped after it has gone
+        _detach_ring()
+)";
+
+// A private worker: its end of the control socket is always fd 3
+const char* kWorkerMain = R"(
+_serve(socket.socket(fileno=3))
+# Skip interpreter teardown: views into the ring may still be referenced
+os._exit(0)
+)";
+
+// Runs before the core in the daemon so thread pools imported with NumPy stay
+// single-threaded: the daemon's parallelism comes from its worker processes
+const char* kDaemonPrelude = R"(
+import os
+for _var in ("OMP_NUM_THREADS", "OPENBLAS_NUM_THREADS", "MKL_NUM_THREADS"):
+    os.environ.setdefault(_var, "1")
+)";
+
+// The shared warm daemon: argv is socket path, worker count, idle timeout in
+// seconds (0 = never) and a comma-separated list of modules to preload. The
+// launcher process exits once the socket is bound; the server continues in a
+// detached grandchild that pre-forks workers after the imports, so every
+// worker starts warm. Workers accept connections on the shared listening
+// socket and serve one client session each; crashed workers are replaced.
+const char* kDaemonMain = R"(
+import fcntl
+import importlib
+import mmap
+import signal
+import struct
+
+def _daemon(path, workers, idle_timeout, preload):
+    for name in filter(None, preload.split(",")):
+        try:
+            importlib.import_module(name)
+        except Exception:
+            pass
+
+    directory = os.path.dirname(path)
+    if directory:
+        os.makedirs(directory, mode=0o700, exist_ok=True)
+    lock = open(path + ".lock", "w")
+    fcntl.flock(lock, fcntl.LOCK_EX)
+
+    probe = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    try:
+        probe.connect(path)
+        return  # another daemon already serves this path
+    except OSError:
+        pass
+    finally:
+        probe.close()
+    try:
+        os.unlink(path)  # stale socket of a daemon that died
+    except FileNotFoundError:
+        pass
+
+    listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    umask = os.umask(0o077)
+    try:
+        listener.bind(path)
+    finally:
+        os.umask(umask)
+    listener.listen(64)
+    inode = os.stat(path).st_ino
+
+    if os.fork() > 0:
+        os._exit(0)
+    os.setsid()
+    fcntl.flock(lock, fcntl.LOCK_UN)
+    devnull = os.open(os.devnull, os.O_RDWR)
+    for fd in (0, 1, 2):
+        os.dup2(devnull, fd)
+    # Nothing the launching app left open may be held for the daemon's lifetime
+    start = 3
+    for keep in sorted((listener.fileno(), lock.fileno())):
+        os.closerange(start, keep)
+        start = keep + 1
+    os.closerange(start, os.sysconf("SC_OPEN_MAX"))
+
+    # One slot per worker, written only by that worker: last activity, busy
+    slot_format = "dq"
+    slot_size = struct.calcsize(slot_format)
+    state = mmap.mmap(-1, slot_size * workers)
+
+    def mark(slot, busy):
+        struct.pack_into(slot_format, state, slot * slot_size, time.time(), busy)
+
+    def worker(slot):
+        signal.signal(signal.SIGTERM, signal.SIG_DFL)
+        while True:
+            connection, _ = listener.accept()
+            mark(slot, 1)
+            try:
+                _serve(connection, lambda: mark(slot, 1))
+            except Exception:
+                pass
+            finally:
+                connection.close()
+                mark(slot, 0)
+
+    children = {}
+
+    def spawn(slot):
+        mark(slot, 0)
+        pid = os.fork()
+        if pid == 0:
+            try:
+                worker(slot)
+            finally:
+                os._exit(0)
+        children[pid] = slot
+
+    stopping = []
+    signal.signal(signal.SIGTERM, lambda *_: stopping.append(True))
+    for slot in range(workers):
+        spawn(slot)
+
+    while not stopping:
+        time.sleep(1)
+        while True:
+            try:
+                pid, _ = os.waitpid(-1, os.WNOHANG)
+            except ChildProcessError:
+                pid = 0
+            if pid == 0:
+                break
+            slot = children.pop(pid, None)
+            if slot is not None and not stopping:
+                spawn(slot)
+
+        if idle_timeout > 0:
+            slots = [struct.unpack_from(slot_format, state, i * slot_size) for i in range(workers)]
+            if all(busy == 0 for _, busy in slots) and time.time() - max(t for t, _ in slots) > idle_timeout:
+                break
+
+    # Unlink first (unless a newer daemon took the path) so clients start afresh
+    fcntl.flock(lock, fcntl.LOCK_EX)
+    try:
+        if os.stat(path).st_ino == inode:
+            os.unlink(path)
+    except FileNotFoundError:
+        pass
+    fcntl.flock(lock, fcntl.LOCK_UN)
+    for pid in children:
+        os.kill(pid, signal.SIGTERM)
+    for pid in children:
+        os.waitpid(pid, 0)
+
+_daemon(sys.argv[1], int(sys.argv[2]), float(sys.argv[3]), sys.argv[4] if len(sys.argv) > 4 else "")
+os._exit(0)
+)";
+
+}
+
+std::string PythonWorkerPool::pythonExecutable() {
+    if (const char* overridePath = std::getenv("CPPPYTHON_PYTHON")) {
+        if (*overridePath) return overridePath;
+    }
+    return CPPPYTHON_PYTHON_EXECUTABLE;
+}
+
+PythonWorkerPool::TraceBuffer::TraceBuffer(TraceBuffer&& other) noexcept
+    : pool(other.pool)
+    , block(other.block)
+    , n(other.n) {
+    other.pool = nullptr;
+}
+
+PythonWorkerPool::TraceBuffer& PythonWorkerPool::TraceBuffer::operator=(TraceBuffer&& other) noexcept {
+    if (this != &other) {
+        if (pool) pool->releaseBlock(block);
+        pool = other.pool;
+        block = other.block;
+        n = other.n;
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+PythonWorkerPool::TraceBuffer::~TraceBuffer() {
+    if (pool) pool->releaseBlock(block);
+}
+
+std::span<double> PythonWorkerPool::TraceBuffer::x() const {
+    return {block.doubles(), pool ? n : 0};
+}
+
+std::span<double> PythonWorkerPool::TraceBuffer::y() const {
+    return {block.doubles() + n, pool ? n : 0};
+}
+
+PythonWorkerPool::Trace PythonWorkerPool::TraceBuffer::trace() const {
+    return {x(), y()};
+}
+
+#ifdef _WIN32
+
+PythonWorkerPool::PythonWorkerPool(size_t) {
+    throw std::runtime_error("Python worker processes are only supported on POSIX systems");
+}
+
+PythonWorkerPool::PythonWorkerPool(const DaemonOptions&) {
+    throw std::runtime_error("The Python worker daemon is only supported on POSIX systems");
+}
+
+PythonWorkerPool::~PythonWorkerPool() = default;
+
+std::string PythonWorkerPool::defaultDaemonSocket() { return {}; }
+size_t PythonWorkerPool::workerCount() const { return 0; }
+void PythonWorkerPool::setRingCapacity(size_t) {}
+PythonWorkerPool::TraceBuffer PythonWorkerPool::allocateTrace(size_t) { return {}; }
+
+std::vector<PythonWorkerPool::JobResult> PythonWorkerPool::map(const std::string&, const std::vector<Trace>&) {
+    return {};
+}
+
+void PythonWorkerPool::startWorker(Worker&) {}
+int PythonWorkerPool::connectDaemon() const { return -1; }
+void PythonWorkerPool::launchDaemon() const {}
+void PythonWorkerPool::stopWorker(Worker&) {}
+void PythonWorkerPool::releaseSessions() {}
+bool PythonWorkerPool::prepareWorker(Worker&, const std::string&, std::string&) { return false; }
+bool PythonWorkerPool::beginSetup(Worker&, const std::string&) { return false; }
+bool PythonWorkerPool::sendMessage(Worker&, const std::string&, const std::string&) { return false; }
+bool PythonWorkerPool::readMessage(Worker&, std::string&, std::string&) { return false; }
+void PythonWorkerPool::ensureRing(size_t) {}
+SharedMemoryRing::Block PythonWorkerPool::allocateJobBlock(size_t) { return {}; }
+void PythonWorkerPool::releaseBlock(const SharedMemoryRing::Block&) {}
+
+#else
+
+namespace {
+
+constexpr int kWorkerControlFd = 3;
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+void setCloseOnExec(int fd) {
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+}
+
+PythonWorkerPool::PythonWorkerPool(size_t workerCount) {
+#ifndef MSG_NOSIGNAL
+    // Without MSG_NOSIGNAL a worker dying mid-message would raise SIGPIPE
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers.resize(workerCount);
+}
+
+PythonWorkerPool::PythonWorkerPool(const DaemonOptions& options)
+    : PythonWorkerPool(options.workers) {
+    if (options.socketPath.size() >= sizeof(sockaddr_un::sun_path)) {
+        throw std::invalid_argument("Daemon socket path is too long: " + options.socketPath);
+    }
+    useDaemon = true;
+    daemon = options;
+    daemon.workers = workers.size();
+}
+
+std::string PythonWorkerPool::defaultDaemonSocket() {
+    // Versioned so an app with a different protocol never talks to an old daemon
+    const char* name = "cpppython-worker-v1.sock";
+    if (const char* runtime = std::getenv("XDG_RUNTIME_DIR")) {
+        if (*runtime) return std::string(runtime) + "/" + name;
+    }
+    return "/tmp/cpppython-" + std::to_string(getuid()) + "/" + name;
+}
+
+PythonWorkerPool::~PythonWorkerPool() {
+    for (auto& worker : workers) {
+        stopWorker(worker);
+    }
+}
+
+size_t PythonWorkerPool::workerCount() const {
+    return workers.size();
+}
+
+void PythonWorkerPool::setRingCapacity(size_t bytes) {
+    ringCapacity = bytes;
+}
+
+void PythonWorkerPool::ensureRing(size_t bytes) {
+    if (ring && ring->capacity() >= bytes) return;
+    if (ring && !ring->empty()) {
+        throw std::runtime_error("Shared memory ring is too small for this job and still holds live traces; "
+                                 "increase the ring capacity");
+    }
+
+    // Workers re-attach lazily when they see a new generation
+    ring = std::make_unique<SharedMemoryRing>(std::max(ringCapacity, bytes));
+    ++ringGeneration;
+}
+
+SharedMemoryRing::Block PythonWorkerPool::allocateJobBlock(size_t n) {
+    size_t bytes = jobBlockBytes(n);
+    ensureRing(bytes);
+    auto block = ring->allocate(bytes);
+    if (!block) {
+        throw std::runtime_error("Shared memory ring is full");
+    }
+    return *block;
+}
+
+void PythonWorkerPool::releaseBlock(const SharedMemoryRing::Block& block) {
+    if (ring && ring->contains(block.data)) {
+        ring->release(block);
+    }
+}
+
+PythonWorkerPool::TraceBuffer PythonWorkerPool::allocateTrace(size_t n) {
+    if (n == 0) {
+        throw std::invalid_argument("Trace must not be empty");
+    }
+
+    TraceBuffer buffer;
+    buffer.block = allocateJobBlock(n);
+    buffer.pool = this;
+    buffer.n = n;
+    return buffer;
+}
+
+int PythonWorkerPool::connectDaemon() const {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    setCloseOnExec(fd);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, daemon.socketPath.c_str(), sizeof(address.sun_path) - 1);
+    int rc;
+    do {
+        rc = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    } while (rc != 0 && errno == EINTR);
+    if (rc != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void PythonWorkerPool::launchDaemon() const {
+    std::string script =
+        std::string(kDaemonPrelude) + kWorkerCore + ScriptResultSchema::pythonHelpers() + kDaemonMain;
+    std::string workerArg = std::to_string(daemon.workers);
+    std::string idleArg = std::to_string(daemon.idleTimeoutSeconds);
+    std::string preloadArg;
+    for (const auto& module : daemon.preload) {
+        preloadArg += (preloadArg.empty() ? "" : ",") + module;
+    }
+
+    std::string executable = pythonExecutable();
+    std::vector<char*> argv = {
+        const_cast<char*>(executable.c_str()),
+        const_cast<char*>("-c"),
+        const_cast<char*>(script.c_str()),
+        const_cast<char*>(daemon.socketPath.c_str()),
+        const_cast<char*>(workerArg.c_str()),
+        const_cast<char*>(idleArg.c_str()),
+        const_cast<char*>(preloadArg.c_str()),
+        nullptr
+    };
+
+    // The launcher exits once the socket is bound (or another daemon already
+    // serves it); the daemon itself lives on detached from this process
+    pid_t pid = -1;
+    int rc = posix_spawnp(&pid, executable.c_str(), nullptr, nullptr, argv.data(), environ);
+    if (rc != 0) {
+        throw std::runtime_error("Could not start Python worker daemon '" + executable + "': " + std::strerror(rc));
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("Python worker daemon failed to start on " + daemon.socketPath);
+    }
+}
+
+void PythonWorkerPool::startWorker(Worker& worker) {
+    if (useDaemon) {
+        int fd = connectDaemon();
+        if (fd < 0) {
+            launchDaemon();
+            fd = connectDaemon();
+        }
+        if (fd < 0) {
+            throw std::runtime_error("Could not connect to the Python worker daemon at " + daemon.socketPath +
+                                     ": " + std::strerror(errno));
+        }
+        worker = Worker{};
+        worker.control = fd;
+        return;
+    }
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        throw std::runtime_error(std::string("Could not create worker control socket: ") + std::strerror(errno));
+    }
+
+    // Neither end may leak into other workers, or a crash would never show up as EOF.
+    // dup2 onto fd 3 clears close-on-exec in the child, unless it is fd 3 already.
+    if (sockets[1] == kWorkerControlFd) {
+        int moved = fcntl(sockets[1], F_DUPFD_CLOEXEC, kWorkerControlFd + 1);
+        close(sockets[1]);
+        sockets[1] = moved;
+    }
+    setCloseOnExec(sockets[0]);
+    setCloseOnExec(sockets[1]);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(sockets[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, sockets[1], kWorkerControlFd);
+
+    std::string executable = pythonExecutable();
+    std::string script = std::string(kWorkerCore) + ScriptResultSchema::pythonHelpers() + kWorkerMain;
+    std::vector<char*> argv = {
+        const_cast<char*>(executable.c_str()),
+        const_cast<char*>("-u"),
+        const_cast<char*>("-c"),
+        const_cast<char*>(script.c_str()),
+        nullptr
+    };
+
+    pid_t pid = -1;
+    int rc = posix_spawnp(&pid, executable.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(sockets[1]);
+
+    if (rc != 0) {
+        close(sockets[0]);
+        throw std::runtime_error("Could not start Python worker '" + executable + "': " + std::strerror(rc));
+    }
+
+    worker.pid = pid;
+    worker.control = sockets[0];
+    worker.readBuffer.clear();
+    worker.loadedScript.clear();
+    worker.ringGeneration = 0;
+    worker.job = -1;
+}
+
+void PythonWorkerPool::stopWorker(Worker& worker) {
+    if (!worker.alive()) return;
+
+    // For a daemon connection this only ends the session; the worker stays warm
+    sendMessage(worker, "quit");
+    close(worker.control);
+
+    if (worker.pid >= 0) {
+        int status = 0;
+        if (waitpid(worker.pid, &status, WNOHANG) == 0) {
+            kill(worker.pid, SIGTERM);
+            waitpid(worker.pid, &status, 0);
+        }
+    }
+
+    worker = Worker{};
+}
+
+bool PythonWorkerPool::sendMessage(Worker& worker, const std::string& header, const std::string& payload) {
+    std::string message = header + " " + std::to_string(payload.size()) + "\n" + payload;
+    const char* data = message.data();
+    size_t remaining = message.size();
+
+    while (remaining > 0) {
+        ssize_t sent = send(worker.control, data, remaining, kSendFlags);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        remaining -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool PythonWorkerPool::readMessage(Worker& worker, std::string& header, std::string& payload) {
+    // Blocks until one complete message is buffered; false on EOF
+    auto fill = [&worker]() {
+        char chunk[4096];
+        ssize_t count;
+        do {
+            count = recv(worker.control, chunk, sizeof(chunk), 0);
+        } while (count < 0 && errno == EINTR);
+        if (count <= 0) return false;
+        worker.readBuffer.append(chunk, static_cast<size_t>(count));
+        return true;
+    };
+
+    size_t newline;
+    while ((newline = worker.readBuffer.find('\n')) == std::string::npos) {
+        if (!fill()) return false;
+    }
+    header = worker.readBuffer.substr(0, newline);
+
+    size_t lengthStart = header.find_last_of(' ');
+    size_t payloadLength = std::stoul(header.substr(lengthStart + 1));
+    header.erase(lengthStart);
+
+    while (worker.readBuffer.size() < newline + 1 + payloadLength) {
+        if (!fill()) return false;
+    }
+    payload = worker.readBuffer.substr(newline + 1, payloadLength);
+    worker.readBuffer.erase(0, newline + 1 + payloadLength);
+    return true;
+}
+
+bool PythonWorkerPool::prepareWorker(Worker& worker, const std::string& script, std::string& error) {
+    if (!worker.alive()) startWorker(worker);
+
+    auto request = [&](const std::string& header, const std::string& payload) {
+        std::string reply, details;
+        if (!sendMessage(worker, header, payload) || !readMessage(worker, reply, details)) {
+            error = "Python worker exited during setup";
+            stopWorker(worker);
+            return false;
+        }
+        if (reply.rfind("err", 0) == 0) {
+            error = details;
+            return false;
+        }
+        return true;
+    };
+
+    if (worker.ringGeneration != ringGeneration) {
+        if (!request("attach " + ring->name(), {})) return false;
+        worker.ringGeneration = ringGeneration;
+    }
+    if (worker.loadedScript != script) {
+        if (!request("script", script)) return false;
+        worker.loadedScript = script;
+    }
+    return true;
+}
+
+bool PythonWorkerPool::beginSetup(Worker& worker, const std::string& script) {
+    // Same steps as prepareWorker, but the replies are picked up by map()
+    if (!worker.alive()) startWorker(worker);
+
+    bool sent = true;
+    if (worker.ringGeneration != ringGeneration) {
+        sent = sendMessage(worker, "attach " + ring->name());
+        worker.ringGeneration = ringGeneration;
+        ++worker.pendingReplies;
+    }
+    if (sent && worker.loadedScript != script) {
+        sent = sendMessage(worker, "script", script);
+        worker.loadedScript = script;
+        ++worker.pendingReplies;
+    }
+    if (!sent) {
+        stopWorker(worker);
+    }
+    return sent;
+}
+
+void PythonWorkerPool::releaseSessions() {
+    // Hands the daemon's workers back for other clients; own workers stay up
+    if (!useDaemon) return;
+    for (auto& worker : workers) {
+        stopWorker(worker);
+    }
+}
+
+std::vector<PythonWorkerPool::JobResult> PythonWorkerPool::map(const std::string& script, const std::vector<Trace>& traces) {
+    std::vector<JobResult> results(traces.size());
+    if (traces.empty()) return results;
+
+    if (script.empty()) {
+        throw std::runtime_error("Python script is empty");
+    }
+
+    size_t largestJob = 0;
+    for (const auto& trace : traces) {
+        if (trace.x.size() != trace.y.size() || trace.x.empty()) {
+            throw std::invalid_argument("Each trace needs non-empty x and y arrays of equal length");
+        }
+        if (!ring || !ring->contains(trace.x.data())) {
+            largestJob = std::max(largestJob, jobBlockBytes(trace.x.size()));
+        }
+    }
+    ensureRing(largestJob);
+
+    // A compile error fails every job the same way. Only as many workers are
+    // prepared as there are jobs. Daemon workers are shared, so only the first
+    // is waited for: the others may be busy with another client, and waiting
+    // on them while holding one deadlocks two clients. They join the map as
+    // soon as the daemon accepts them.
+    std::string setupError;
+    size_t sessions = std::min(workers.size(), traces.size());
+    for (size_t i = 0; i < sessions; ++i) {
+        auto& worker = workers[i];
+        if (useDaemon && i > 0) {
+            try {
+                beginSetup(worker, script);
+            } catch (const std::exception&) {
+                // Runs on the sessions it has
+            }
+            continue;
+        }
+        if (!prepareWorker(worker, script, setupError)) {
+            for (auto& result : results) {
+                result.error = setupError;
+            }
+            releaseSessions();
+            return results;
+        }
+    }
+
+    struct InFlight {
+        SharedMemoryRing::Block block;
+        size_t n = 0;
+        bool ownsBlock = false;
+    };
+    std::map<long, InFlight> inFlight;
+    size_t nextJob = 0;
+    size_t completed = 0;
+
+    auto finishJob = [&](long job, const std::string& error) {
+        results[job].ok = error.empty();
+        results[job].error = error;
+        auto it = inFlight.find(job);
+        if (it != inFlight.end()) {
+            if (it->second.ownsBlock) ring->release(it->second.block);
+            inFlight.erase(it);
+        }
+        ++completed;
+    };
+
+    auto dispatch = [&](Worker& worker) {
+        while (worker.alive() && worker.pendingReplies == 0 && worker.job < 0 && nextJob < traces.size()) {
+            long job = static_cast<long>(nextJob);
+            const auto& trace = traces[job];
+
+            InFlight entry;
+            entry.n = trace.x.size();
+            if (ring->contains(trace.x.data())) {
+                // TraceBuffer storage: already in place, the worker reads it directly
+                if (trace.y.data() != trace.x.data() + entry.n) {
+                    throw std::invalid_argument("Ring-resident traces must come from PythonWorkerPool::allocateTrace");
+                }
+                entry.block.offset = ring->offsetOf(trace.x.data());
+                entry.block.data = const_cast<double*>(trace.x.data());
+            } else {
+                auto block = ring->allocate(jobBlockBytes(entry.n));
+                if (!block) {
+                    // Ring full: wait for in-flight jobs to hand their blocks back
+                    if (inFlight.empty()) {
+                        throw std::runtime_error("Shared memory ring is full of live traces; "
+                                                 "increase the ring capacity");
+                    }
+                    return;
+                }
+                entry.block = *block;
+                entry.ownsBlock = true;
+                std::memcpy(entry.block.doubles(), trace.x.data(), entry.n * sizeof(double));
+                std::memcpy(entry.block.doubles() + entry.n, trace.y.data(), entry.n * sizeof(double));
+            }
+            ++nextJob;
+
+            std::ostringstream header;
+            header << "run " << job << " " << entry.block.offset / sizeof(double)
+                   << " " << entry.n << " " << resultCapacity(entry.n);
+            inFlight.emplace(job, entry);
+            worker.job = job;
+
+            if (!sendMessage(worker, header.str())) {
+                stopWorker(worker);
+                finishJob(job, "Python worker process exited unexpectedly");
+            }
+        }
+    };
+
+    // Workers past `sessions` may still hold an older script or ring
+    auto dispatchAll = [&]() {
+        for (size_t i = 0; i < sessions; ++i) {
+            dispatch(workers[i]);
+        }
+    };
+
+    dispatchAll();
+
+    while (completed < traces.size()) {
+        bool anyAlive = false;
+        for (auto& worker : workers) {
+            anyAlive = anyAlive || worker.alive();
+        }
+        if (!anyAlive) {
+            for (size_t job = 0; job < traces.size(); ++job) {
+                if (!results[job].ok && results[job].error.empty()) {
+                    results[job].error = "No Python worker could be started";
+                }
+            }
+            break;
+        }
+
+        std::vector<pollfd> fds;
+        for (auto& worker : workers) {
+            fds.push_back({worker.control, POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("poll on Python workers failed: ") + std::strerror(errno));
+        }
+
+        for (size_t i = 0; i < workers.size(); ++i) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            Worker& worker = workers[i];
+
+            std::string header, payload;
+            if (!readMessage(worker, header, payload)) {
+                // Crash isolation: only this worker's job fails, the worker is replaced
+                long job = worker.job;
+                stopWorker(worker);
+                if (job >= 0) {
+                    finishJob(job, "Python worker process exited unexpectedly");
+                }
+                if (completed < traces.size()) {
+                    try {
+                        beginSetup(worker, script);
+                    } catch (const std::exception&) {
+                        // Left stopped; the remaining workers carry on
+                    }
+                }
+                continue;
+            }
+
+            if (worker.pendingReplies > 0) {
+                // A beginSetup() step; a worker that fails it sits this map out
+                --worker.pendingReplies;
+                if (header.rfind("err", 0) == 0) {
+                    stopWorker(worker);
+                }
+                dispatch(worker);
+                continue;
+            }
+
+            std::istringstream fields(header);
+            std::string status;
+            long job = -1;
+            size_t fitPoints = 0;
+            size_t outputBytes = 0;
+            fields >> status >> job;
+            if (status == "ok") fields >> fitPoints;
+            fields >> outputBytes;
+            worker.job = -1;
+
+            auto it = inFlight.find(job);
+            if (it == inFlight.end()) continue;
+            outputBytes = std::min(outputBytes, payload.size());
+            results[job].output = payload.substr(0, outputBytes);
+            payload.erase(0, outputBytes);
+
+            if (status == "ok") {
+                const InFlight& entry = it->second;
+                const double* scalars = entry.block.doubles() + 2 * entry.n;
+                const double* fitX = scalars + kHeaderDoubles;
+                const double* fitY = fitX + resultCapacity(entry.n);
+                auto value = [](double v) { return std::isnan(v) ? 0.0 : v; };
+
+                auto& fit = results[job].fit;
+                fit.fit_x.assign(fitX, fitX + fitPoints);
+                fit.fit_y.assign(fitY, fitY + fitPoints);
+                fit.amplitude = value(scalars[0]);
+                fit.frequency = value(scalars[1]);
+                fit.phase = value(scalars[2]);
+                fit.offset = value(scalars[3]);
+                fit.r_squared = value(scalars[4]);
+                fit.rmse = value(scalars[5]);
+                fit.aic = value(scalars[6]);
+                for (int p = 0; p < 4; ++p) {
+                    fit.param_errors[p] = value(scalars[7 + p]);
+                }
+                fit.fit_time = std::chrono::microseconds(static_cast<long long>(value(scalars[11])));
+                finishJob(job, {});
+            } else {
+                finishJob(job, payload.empty() ? "Python worker reported an error" : payload);
+            }
+        }
+
+        // Freed blocks may unblock workers that were waiting for ring space
+        dispatchAll();
+    }
+
+    releaseSessions();
+    return results;
+}
+
+#endif
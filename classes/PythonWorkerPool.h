@@ -0,0 +1,122 @@
+// PythonWorkerPool.h - Out-of-process Python workers for batch analyses
+#pragma once
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "CppSineFitter.h"
+#include "SharedMemoryRing.h"
+
+// Runs analysis scripts in python3 worker processes. Trace data and fit
+// results travel through one shared memory ring that every worker maps once;
+// a Unix socket per worker only carries short control messages. Each worker
+// has its own interpreter and GIL, so throughput scales with the number of
+// cores, and a crashing script only takes down its worker.
+//
+// Alternatively the workers come from a shared daemon (see DaemonOptions)
+// that outlives the app: its workers keep modules imported and scripts
+// compiled, so several app instances and fit_bench reuse warm interpreters.
+class PythonWorkerPool {
+public:
+    struct DaemonOptions {
+        std::string socketPath = defaultDaemonSocket();
+        size_t workers = 0;          // daemon size if this pool starts it; 0 = hardware threads
+        double idleTimeoutSeconds = 600;  // the daemon exits after this long unused; 0 = never
+        std::vector<std::string> preload{"numpy", "scipy.optimize"};
+    };
+
+    struct Trace {
+        std::span<const double> x;
+        std::span<const double> y;
+    };
+
+    struct JobResult {
+        bool ok = false;
+        std::string error;
+        CppSineFitter::FitResult fit = {};
+        std::string output;  // the script's stdout/stderr, at most its last 64K characters
+    };
+
+    // Trace storage allocated directly inside the shared ring. Fill x()/y() in
+    // place and pass trace() to map(): the workers read it without any copy.
+    // Must not outlive the pool.
+    class TraceBuffer {
+    public:
+        TraceBuffer() = default;
+        TraceBuffer(TraceBuffer&& other) noexcept;
+        TraceBuffer& operator=(TraceBuffer&& other) noexcept;
+        ~TraceBuffer();
+
+        std::span<double> x() const;
+        std::span<double> y() const;
+        Trace trace() const;
+
+    private:
+        friend class PythonWorkerPool;
+        PythonWorkerPool* pool = nullptr;
+        SharedMemoryRing::Block block;
+        size_t n = 0;
+    };
+
+    // workerCount == 0 uses one worker per hardware thread
+    explicit PythonWorkerPool(size_t workerCount = 0);
+    // Connects to the daemon at options.socketPath, starting it (detached) if
+    // nothing is listening. Connections are held only while map() runs, so
+    // idle app instances leave the daemon's workers free for others.
+    explicit PythonWorkerPool(const DaemonOptions& options);
+    ~PythonWorkerPool();
+
+    PythonWorkerPool(const PythonWorkerPool&) = delete;
+    PythonWorkerPool& operator=(const PythonWorkerPool&) = delete;
+
+    size_t workerCount() const;
+
+    // Initial ring size; the ring only grows (when idle) to fit larger jobs.
+    // Pages are committed on first touch, so a generous size costs nothing.
+    void setRingCapacity(size_t bytes);
+
+    TraceBuffer allocateTrace(size_t n);
+
+    // Runs `script` once per trace and gathers the results in trace order.
+    // Failures are reported per job; a crashed worker is restarted.
+    std::vector<JobResult> map(const std::string& script, const std::vector<Trace>& traces);
+
+    static std::string pythonExecutable();
+    // Per-user socket in $XDG_RUNTIME_DIR, else /tmp/cpppython-<uid>
+    static std::string defaultDaemonSocket();
+
+private:
+    struct Worker {
+        int pid = -1;
+        int control = -1;
+        std::string readBuffer;
+        std::string loadedScript;
+        unsigned ringGeneration = 0;
+        long job = -1;
+        int pendingReplies = 0;  // setup steps sent by beginSetup() and not yet answered
+
+        bool alive() const { return control >= 0; }
+    };
+
+    void startWorker(Worker& worker);
+    int connectDaemon() const;
+    void launchDaemon() const;
+    void stopWorker(Worker& worker);
+    void releaseSessions();
+    bool prepareWorker(Worker& worker, const std::string& script, std::string& error);
+    bool beginSetup(Worker& worker, const std::string& script);
+    bool sendMessage(Worker& worker, const std::string& header, const std::string& payload = {});
+    bool readMessage(Worker& worker, std::string& header, std::string& payload);
+
+    void ensureRing(size_t bytes);
+    SharedMemoryRing::Block allocateJobBlock(size_t n);
+    void releaseBlock(const SharedMemoryRing::Block& block);
+
+    std::vector<Worker> workers;
+    std::unique_ptr<SharedMemoryRing> ring;
+    unsigned ringGeneration = 0;
+    size_t ringCapacity = size_t(256) << 20;
+
+    bool useDaemon = false;
+    DaemonOptions daemon;
+};
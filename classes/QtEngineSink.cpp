@@ -0,0 +1,55 @@
+#include "QtEngineSink.h"
+#include <QtCore/QTimer>
+
+QtEngineSink::QtEngineSink(QTextEdit* output, int intervalMs)
+    : output(output), intervalMs(intervalMs) {
+}
+
+void QtEngineSink::setMaxPendingBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxPendingBytes = bytes;
+}
+
+void QtEngineSink::write(Kind, std::string_view text) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.size() + text.size() + 1 > maxPendingBytes) {
+            droppedBytes += text.size() + 1;
+        } else {
+            if (!pending.empty()) pending += '\n';
+            pending.append(text.data(), text.size());
+        }
+    }
+    // The first write after a flush arms the timer; later ones ride along
+    if (!flushScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, [this]() { scheduleFlush(); }, Qt::QueuedConnection);
+    }
+}
+
+void QtEngineSink::scheduleFlush() {
+    QTimer::singleShot(intervalMs, this, [this]() { flush(); });
+}
+
+void QtEngineSink::flush() {
+    // Cleared first: a write racing with this flush schedules the next one
+    flushScheduled = false;
+
+    std::string text;
+    size_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        text.swap(pending);
+        dropped = droppedBytes;
+        droppedBytes = 0;
+    }
+    if (!output || (text.empty() && dropped == 0)) return;
+
+    // One append per flush: append() splits the text into paragraphs itself
+    if (!text.empty()) {
+        output->append(QString::fromUtf8(text.data(), static_cast<int>(text.size())));
+    }
+    if (dropped > 0) {
+        output->append(QString("[output truncated: %1 bytes dropped]").arg(dropped));
+    }
+    output->ensureCursorVisible();
+}
@@ -0,0 +1,40 @@
+// QtEngineSink.h - Batches engine output onto a QTextEdit with throttled repaints
+#pragma once
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtWidgets/QTextEdit>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include "EngineSink.h"
+
+// Writes from any thread are queued; the widget is updated on the GUI thread
+// at most once per interval, with everything queued in a single append. Owned
+// through a shared_ptr (the engine keeps one), so it takes no QObject parent.
+class QtEngineSink : public QObject, public EngineSink {
+    Q_OBJECT
+
+public:
+    explicit QtEngineSink(QTextEdit* output, int intervalMs = 50);
+
+    void write(Kind kind, std::string_view text) override;
+
+    // GUI thread: shows everything queued so far right away, e.g. before the
+    // caller appends its own text to the same widget
+    void flush();
+
+    // Queued text beyond this is dropped (and counted) until the next flush
+    void setMaxPendingBytes(size_t bytes);
+
+private:
+    void scheduleFlush();
+
+    QPointer<QTextEdit> output;
+    int intervalMs;
+
+    std::mutex mutex;
+    std::string pending;          // lines joined by '\n'
+    size_t maxPendingBytes = size_t(4) << 20;
+    size_t droppedBytes = 0;
+    std::atomic<bool> flushScheduled{false};
+};
@@ -0,0 +1,66 @@
+#include "ScriptResultSchema.h"
+
+namespace {
+
+const ScriptResultSchema::Field kFields[] = {
+    {.name = "fit_x", .required = true, .array = &ScriptResultSchema::FitResult::fit_x},
+    {.name = "fit_y", .required = true, .array = &ScriptResultSchema::FitResult::fit_y},
+    {.name = "amplitude", .required = true, .scalar = &ScriptResultSchema::FitResult::amplitude},
+    {.name = "frequency", .required = true, .scalar = &ScriptResultSchema::FitResult::frequency},
+    {.name = "phase", .required = true, .scalar = &ScriptResultSchema::FitResult::phase},
+    {.name = "offset", .required = false, .scalar = &ScriptResultSchema::FitResult::offset},
+    {.name = "r_squared", .required = false, .scalar = &ScriptResultSchema::FitResult::r_squared},
+    {.name = "rmse", .required = false, .scalar = &ScriptResultSchema::FitResult::rmse},
+    {.name = "aic", .required = false, .scalar = &ScriptResultSchema::FitResult::aic},
+    {.name = "param_errors", .required = false, .params = &ScriptResultSchema::FitResult::param_errors},
+};
+
+const char* kHelpers = R"(
+import dataclasses
+
+def _result_mapping(namespace):
+    """Return the script's structured `result` as a dict, or None if it has none.
+    Only a plain dict or a dataclass instance counts; anything else named
+    `result` (e.g. scipy's OptimizeResult) leaves the legacy globals in charge"""
+    result = namespace.get("result")
+    if type(result) is dict:
+        return result
+    if dataclasses.is_dataclass(result) and not isinstance(result, type):
+        return {f.name: getattr(result, f.name) for f in dataclasses.fields(result)}
+    return None
+
+def _result_source(namespace):
+    mapping = _result_mapping(namespace)
+    return namespace if mapping is None else mapping
+
+def _require_result_fields(source):
+    missing = [f"missing '{name}'" for name in _REQUIRED_RESULT_FIELDS if source.get(name) is None]
+    if missing:
+        raise ValueError("Invalid script result: " + "; ".join(missing))
+)";
+
+}
+
+std::span<const ScriptResultSchema::Field> ScriptResultSchema::fields() {
+    return kFields;
+}
+
+const std::string& ScriptResultSchema::pythonHelpers() {
+    // The required names come from the table above, not a second list
+    static const std::string source = [] {
+        std::string required = "\n_REQUIRED_RESULT_FIELDS = (";
+        for (const Field& field : kFields) {
+            if (field.required) required += std::string("\"") + field.name + "\", ";
+        }
+        return required + ")\n" + kHelpers;
+    }();
+    return source;
+}
+
+std::string ScriptResultSchema::invalidMessage(const std::vector<std::string>& problems) {
+    std::string message = "Invalid script result: ";
+    for (size_t i = 0; i < problems.size(); ++i) {
+        message += (i ? "; " : "") + problems[i];
+    }
+    return message;
+}
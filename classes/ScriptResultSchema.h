@@ -0,0 +1,36 @@
+// ScriptResultSchema.h - The fit result an analysis script publishes
+#pragma once
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+#include "CppSineFitter.h"
+
+// Shared by the embedded engine and the batch worker processes, so a script
+// is judged the same either way. A script publishes a `result` dict or
+// dataclass; without one, or with a `result` of any other type (e.g. scipy's
+// OptimizeResult), its legacy globals (fit_x, fit_y, amplitude, ...) count.
+class ScriptResultSchema {
+public:
+    using FitResult = CppSineFitter::FitResult;
+
+    // Exactly one of the member pointers is set
+    struct Field {
+        const char* name;
+        bool required;
+        std::vector<double> FitResult::* array = nullptr;
+        double FitResult::* scalar = nullptr;
+        std::array<double, 4> FitResult::* params = nullptr;
+    };
+
+    static std::span<const Field> fields();
+
+    // Python source defining, for a run namespace:
+    //   _result_mapping(ns)         the structured result as a dict, or None
+    //   _result_source(ns)          where the fields are read from
+    //   _require_result_fields(src) raises ValueError naming missing required fields
+    static const std::string& pythonHelpers();
+
+    // "Invalid script result: " followed by the problems, as both sides report it
+    static std::string invalidMessage(const std::vector<std::string>& problems);
+};
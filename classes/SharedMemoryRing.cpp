@@ -0,0 +1,83 @@
+#include "SharedMemoryRing.h"
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+
+// Cache-line aligned blocks keep worker-side NumPy views aligned as well
+constexpr size_t kBlockAlignment = 64;
+
+size_t alignUp(size_t value) {
+    return (value + kBlockAlignment - 1) & ~(kBlockAlignment - 1);
+}
+
+}
+
+SharedMemoryRing::SharedMemoryRing(size_t capacityBytes)
+    : segment(SharedMemorySegment::create(alignUp(std::max<size_t>(capacityBytes, kBlockAlignment)))) {
+}
+
+std::optional<SharedMemoryRing::Block> SharedMemoryRing::allocate(size_t bytes) {
+    size_t size = alignUp(std::max<size_t>(bytes, 1));
+    if (size > capacity()) return std::nullopt;
+
+    size_t offset;
+    if (blocks.empty()) {
+        offset = 0;
+    } else {
+        size_t tail = blocks.front().offset;
+        if (head > tail) {
+            // Live data in [tail, head): use the end, else wrap to the start
+            if (capacity() - head >= size) {
+                offset = head;
+            } else if (tail >= size) {
+                offset = 0;
+            } else {
+                return std::nullopt;
+            }
+        } else {
+            // Wrapped: live data in [tail, end) and [0, head)
+            if (tail - head >= size) {
+                offset = head;
+            } else {
+                return std::nullopt;
+            }
+        }
+    }
+
+    blocks.push_back({offset, size, false});
+    head = offset + size;
+    usedBytes += size;
+    return Block{offset, size, static_cast<char*>(segment.data()) + offset};
+}
+
+void SharedMemoryRing::release(const Block& block) {
+    auto it = std::find_if(blocks.begin(), blocks.end(), [&block](const Entry& entry) {
+        return entry.offset == block.offset && !entry.released;
+    });
+    if (it == blocks.end()) {
+        throw std::logic_error("Releasing a block that is not live in this ring");
+    }
+
+    it->released = true;
+    usedBytes -= it->size;
+
+    while (!blocks.empty() && blocks.front().released) {
+        blocks.pop_front();
+    }
+    // Releasing the newest blocks hands their space straight back to head
+    while (!blocks.empty() && blocks.back().released) {
+        blocks.pop_back();
+    }
+    head = blocks.empty() ? 0 : blocks.back().offset + blocks.back().size;
+}
+
+size_t SharedMemoryRing::offsetOf(const void* pointer) const {
+    return static_cast<size_t>(static_cast<const char*>(pointer) - static_cast<const char*>(segment.data()));
+}
+
+bool SharedMemoryRing::contains(const void* pointer) const {
+    auto* base = static_cast<const char*>(segment.data());
+    auto* p = static_cast<const char*>(pointer);
+    return base && p >= base && p < base + capacity();
+}
@@ -0,0 +1,46 @@
+// SharedMemoryRing.h - Ring allocator over one shared memory segment
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <string>
+#include "SharedMemorySegment.h"
+
+// Hands out blocks from a single POSIX shared memory segment that worker
+// processes map once. Blocks may be released in any order; space is reclaimed
+// from the oldest end as soon as every older block is released.
+class SharedMemoryRing {
+public:
+    struct Block {
+        size_t offset = 0;  // bytes from the start of the segment
+        size_t size = 0;
+        void* data = nullptr;
+
+        double* doubles() const { return static_cast<double*>(data); }
+    };
+
+    explicit SharedMemoryRing(size_t capacityBytes);
+
+    // nullopt when the ring currently has no contiguous room for `bytes`
+    std::optional<Block> allocate(size_t bytes);
+    void release(const Block& block);
+
+    bool contains(const void* pointer) const;
+    size_t offsetOf(const void* pointer) const;
+    bool empty() const { return blocks.empty(); }
+    size_t capacity() const { return segment.size(); }
+    size_t used() const { return usedBytes; }
+    std::string name() const { return segment.name(); }
+
+private:
+    struct Entry {
+        size_t offset;
+        size_t size;
+        bool released;
+    };
+
+    SharedMemorySegment segment;
+    std::deque<Entry> blocks;  // allocation order
+    size_t head = 0;           // next free byte
+    size_t usedBytes = 0;
+};
@@ -0,0 +1,91 @@
+#include "SharedMemorySegment.h"
+#include <stdexcept>
+#include <atomic>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+SharedMemorySegment SharedMemorySegment::create(size_t bytes) {
+#ifdef _WIN32
+    (void)bytes;
+    throw std::runtime_error("Shared memory segments are only supported on POSIX systems");
+#else
+    static std::atomic<unsigned long> counter{0};
+
+    if (bytes == 0) {
+        throw std::invalid_argument("Shared memory segment size must be positive");
+    }
+
+    SharedMemorySegment segment;
+    // Short names: macOS limits POSIX shm names to 31 characters
+    segment.shmName = "/cpy" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+
+    int fd = shm_open(segment.shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("shm_open failed for " + segment.shmName + ": " + std::strerror(errno));
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        int err = errno;
+        close(fd);
+        shm_unlink(segment.shmName.c_str());
+        throw std::runtime_error("Could not size shared memory segment: " + std::string(std::strerror(err)));
+    }
+
+    void* address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        int err = errno;
+        shm_unlink(segment.shmName.c_str());
+        throw std::runtime_error("Could not map shared memory segment: " + std::string(std::strerror(err)));
+    }
+
+    segment.address = address;
+    segment.length = bytes;
+    return segment;
+#endif
+}
+
+SharedMemorySegment::SharedMemorySegment(SharedMemorySegment&& other) noexcept
+    : shmName(std::move(other.shmName))
+    , address(other.address)
+    , length(other.length) {
+    other.address = nullptr;
+    other.length = 0;
+}
+
+SharedMemorySegment& SharedMemorySegment::operator=(SharedMemorySegment&& other) noexcept {
+    if (this != &other) {
+        release();
+        shmName = std::move(other.shmName);
+        address = other.address;
+        length = other.length;
+        other.address = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+SharedMemorySegment::~SharedMemorySegment() {
+    release();
+}
+
+std::string SharedMemorySegment::name() const {
+    return shmName.empty() ? shmName : shmName.substr(1);
+}
+
+void SharedMemorySegment::release() {
+#ifndef _WIN32
+    if (address) {
+        munmap(address, length);
+        shm_unlink(shmName.c_str());
+    }
+#endif
+    address = nullptr;
+    length = 0;
+}
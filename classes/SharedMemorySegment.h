@@ -0,0 +1,31 @@
+// SharedMemorySegment.h - RAII wrapper around a POSIX shared memory block
+#pragma once
+#include <cstddef>
+#include <string>
+
+class SharedMemorySegment {
+public:
+    // Creates a new, uniquely named segment owned (and unlinked) by this object
+    static SharedMemorySegment create(size_t bytes);
+
+    SharedMemorySegment() = default;
+    SharedMemorySegment(SharedMemorySegment&& other) noexcept;
+    SharedMemorySegment& operator=(SharedMemorySegment&& other) noexcept;
+    SharedMemorySegment(const SharedMemorySegment&) = delete;
+    SharedMemorySegment& operator=(const SharedMemorySegment&) = delete;
+    ~SharedMemorySegment();
+
+    // Name without the leading '/', as expected by multiprocessing.shared_memory
+    std::string name() const;
+    void* data() const { return address; }
+    double* doubles() const { return static_cast<double*>(address); }
+    size_t size() const { return length; }
+    bool isValid() const { return address != nullptr; }
+
+private:
+    void release();
+
+    std::string shmName;
+    void* address = nullptr;
+    size_t length = 0;
+};
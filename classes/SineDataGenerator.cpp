@@ -0,0 +1,85 @@
+#include "SineDataGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+SineDataGenerator::Trace SineDataGenerator::generate(std::mt19937& rng) {
+    return generate(rng, Options{});
+}
+
+SineDataGenerator::Trace SineDataGenerator::generate(std::mt19937& rng, const Options& options) {
+    if (options.points < 2) {
+        throw std::invalid_argument("SineDataGenerator needs at least 2 points");
+    }
+    if (options.segments < 1) {
+        throw std::invalid_argument("SineDataGenerator needs at least 1 segment");
+    }
+
+    const size_t numPoints = options.points;
+    const size_t segments = static_cast<size_t>(options.segments);
+    const size_t pointsPerSegment = numPoints / segments;
+
+    Trace trace;
+    trace.x.reserve(numPoints);
+    trace.y.reserve(numPoints);
+
+    // More reasonable random distributions
+    std::uniform_real_distribution<double> amplitude_dist(0.8, 2.2);     // Moderate amplitude changes
+    std::uniform_real_distribution<double> frequency_dist(0.8, 2.5);     // Reasonable frequency variations
+    std::uniform_real_distribution<double> phase_dist(0.0, 2.0 * M_PI);  // Random phase shifts
+    std::uniform_real_distribution<double> noise_dist(-0.8, 0.8);        // Stronger but reasonable noise
+    std::uniform_real_distribution<double> offset_dist(-1.0, 1.0);       // Moderate DC offset
+    std::uniform_real_distribution<double> unit_dist(0.0, 1.0);
+    std::uniform_real_distribution<double> spike_dist(-options.outlierSize, options.outlierSize);
+
+    // Initialize with base parameters
+    double prev_amplitude = amplitude_dist(rng);
+    double prev_frequency = frequency_dist(rng);
+    double prev_phase = phase_dist(rng);
+    double prev_offset = offset_dist(rng);
+
+    for (size_t seg = 0; seg < segments; ++seg) {
+        // Gradually change parameters for smoother transitions
+        double amplitude = prev_amplitude + std::uniform_real_distribution<double>(-0.5, 0.5)(rng);
+        double frequency = prev_frequency + std::uniform_real_distribution<double>(-0.3, 0.3)(rng);
+        double phase = prev_phase + std::uniform_real_distribution<double>(-M_PI/2, M_PI/2)(rng);
+        double offset = prev_offset + std::uniform_real_distribution<double>(-0.5, 0.5)(rng);
+
+        // Keep parameters within reasonable bounds
+        amplitude = std::max(0.5, std::min(3.0, amplitude));
+        frequency = std::max(0.5, std::min(3.0, frequency));
+        offset = std::max(-2.0, std::min(2.0, offset));
+
+        size_t startIdx = seg * pointsPerSegment;
+        size_t endIdx = (seg == segments - 1) ? numPoints : (seg + 1) * pointsPerSegment;
+
+        for (size_t i = startIdx; i < endIdx; ++i) {
+            // Smooth x progression with minimal randomness
+            double x_base = (2.0 * M_PI * i / (numPoints - 1));
+            double x_noise = noise_dist(rng) * 0.05;  // Very small x-axis noise
+            double x = x_base + x_noise;
+
+            double y_base = amplitude * std::sin(frequency * x + phase) + offset;
+            double y_noise = noise_dist(rng) * options.noise;
+
+            // Occasional spikes; the check and the spike are always drawn so
+            // the sequence does not depend on the rate
+            bool outlier = unit_dist(rng) < options.outlierRate;
+            double spike = spike_dist(rng);
+            if (outlier) {
+                y_noise += spike;
+            }
+
+            trace.x.push_back(x);
+            trace.y.push_back(y_base + y_noise);
+        }
+
+        // Update previous parameters for next segment
+        prev_amplitude = amplitude;
+        prev_frequency = frequency;
+        prev_phase = phase;
+        prev_offset = offset;
+    }
+
+    return trace;
+}
@@ -0,0 +1,29 @@
+// SineDataGenerator.h - Qt-free synthetic noisy sine traces
+#pragma once
+#include <random>
+#include <vector>
+
+// The recipe behind the plot's generated data: a few segments whose
+// amplitude, frequency, phase and offset drift from one to the next, slightly
+// jittered x over [0, 2π], uniform noise and occasional spikes. Shared by the
+// GUI and the headless benchmark so both fit the same kind of trace.
+class SineDataGenerator {
+public:
+    struct Options {
+        size_t points = 100;
+        int segments = 3;
+        double noise = 0.3;         // y noise is uniform in ±0.8 * noise
+        double outlierRate = 0.05;  // chance of a spike per point
+        double outlierSize = 1.5;   // spikes are uniform in ±outlierSize
+    };
+
+    struct Trace {
+        std::vector<double> x;
+        std::vector<double> y;
+    };
+
+    // The same seed and options reproduce a trace; throws
+    // std::invalid_argument for fewer than 2 points or no segments
+    static Trace generate(std::mt19937& rng);
+    static Trace generate(std::mt19937& rng, const Options& options);
+};
@@ -0,0 +1,135 @@
+#include "SpectrogramWidget.h"
+#include <algorithm>
+#include <stdexcept>
+#include <QVBoxLayout>
+
+SpectrogramWidget::SpectrogramWidget(const StreamingSpectrogram::Config& config, QWidget* parent)
+    : QWidget(parent)
+    , plot(new QCustomPlot(this)) {
+    if (config.history < 2) throw std::invalid_argument("History must be at least two columns");
+    // The worker only asks for a frame; the frame reads whatever arrived by then
+    spectrogram = std::make_unique<StreamingSpectrogram>(config, [this]() {
+        if (framePosted.exchange(true)) return;
+        QMetaObject::invokeMethod(this, [this]() {
+            layers->invalidateAll();
+            frames->schedule();
+        }, Qt::QueuedConnection);
+    });
+    const StreamingSpectrogram::Config& settings = spectrogram->config();
+    const int columns = static_cast<int>(settings.history);
+    const int bins = static_cast<int>(spectrogram->bins());
+
+    auto* layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(plot);
+    plot->setMinimumSize(300, 200);
+
+    plot->xAxis->setLabel("Time (s)");
+    plot->yAxis->setLabel("Frequency (Hz)");
+    // Bin centres run from 0 to Nyquist; the outer cells reach half a bin past
+    double halfBin = spectrogram->binWidth() / 2;
+    plot->yAxis->setRange(-halfBin, settings.sampleRate / 2 + halfBin);
+
+    colorScale = new QCPColorScale(plot);
+    plot->plotLayout()->addElement(0, 1, colorScale);
+    colorScale->setType(QCPAxis::atRight);
+    colorScale->setLabel("Level (dB)");
+    QCPColorGradient gradient(QCPColorGradient::gpThermal);
+    gradient.setNanHandling(QCPColorGradient::nhTransparent);  // columns not written yet
+    colorScale->setGradient(gradient);
+    colorScale->setDataRange(QCPRange(-120, 0));
+    auto* margins = new QCPMarginGroup(plot);
+    plot->axisRect()->setMarginGroup(QCP::msBottom | QCP::msTop, margins);
+    colorScale->setMarginGroup(QCP::msBottom | QCP::msTop, margins);
+
+    for (auto& segment : segments) {
+        segment = new IncrementalColorMap(plot->xAxis, plot->yAxis);
+        segment->setSelectable(QCP::stNone);
+        segment->setInterpolate(false);
+        segment->setTightBoundary(true);
+        segment->setColorScale(colorScale);
+        segment->data()->setSize(columns, bins);
+        segment->data()->setValueRange(QCPRange(0, settings.sampleRate / 2));
+        segment->data()->fill(qQNaN());
+    }
+
+    layers = std::make_unique<LayerDirtyTracker>(plot);
+    frames = std::make_unique<FrameScheduler>(plot, layers.get(), [this]() {
+        framePosted = false;
+        drainColumns();
+    });
+    showLatest();
+}
+
+SpectrogramWidget::~SpectrogramWidget() = default;
+
+void SpectrogramWidget::push(std::span<const double> samples) {
+    spectrogram->push(samples);
+}
+
+void SpectrogramWidget::setLevelRange(double minDb, double maxDb) {
+    if (!(maxDb > minDb)) throw std::invalid_argument("Level range must have max_db above min_db");
+    colorScale->setDataRange(QCPRange(minDb, maxDb));
+    layers->invalidateAll();
+    frames->schedule();
+}
+
+void SpectrogramWidget::clear() {
+    spectrogram->reset();
+    for (size_t slot = 0; slot < segments.size(); ++slot) {
+        segments[slot]->data()->fill(qQNaN());
+        segments[slot]->recolorAll();
+        segmentBlocks[slot] = kNoBlock;
+    }
+    nextColumn = spectrogram->stats().columns;
+    showLatest();
+    layers->invalidateAll();
+    frames->schedule();
+}
+
+StreamingSpectrogram::Stats SpectrogramWidget::stats() const {
+    return spectrogram->stats();
+}
+
+FrameScheduler::Stats SpectrogramWidget::frameStats() const {
+    return frames->stats();
+}
+
+void SpectrogramWidget::drainColumns() {
+    const int bins = static_cast<int>(spectrogram->bins());
+    const uint64_t history = spectrogram->config().history;
+    uint64_t first = nextColumn;
+    nextColumn = spectrogram->readColumns(nextColumn, [&](uint64_t column, std::span<const float> levels) {
+        IncrementalColorMap* segment = segmentFor(column);
+        int key = static_cast<int>(column % history);
+        QCPColorMapData* cells = segment->data();
+        for (int bin = 0; bin < bins; ++bin) cells->setCell(key, bin, levels[bin]);
+        segment->cellsChanged(QRect(key, 0, 1, bins));
+    });
+    if (nextColumn != first) showLatest();
+}
+
+IncrementalColorMap* SpectrogramWidget::segmentFor(uint64_t column) {
+    const uint64_t history = spectrogram->config().history;
+    uint64_t block = column / history;
+    size_t slot = static_cast<size_t>(block % 2);
+    IncrementalColorMap* segment = segments[slot];
+    if (segmentBlocks[slot] != block) {
+        // Its old block is two back, already scrolled out of view
+        segmentBlocks[slot] = block;
+        segment->data()->setKeyRange(QCPRange(spectrogram->columnTime(block * history),
+                                              spectrogram->columnTime((block + 1) * history - 1)));
+        segment->data()->fill(qQNaN());
+        segment->recolorAll();
+    }
+    return segment;
+}
+
+void SpectrogramWidget::showLatest() {
+    // The newest column at the right edge and `history` columns in view
+    const StreamingSpectrogram::Config& settings = spectrogram->config();
+    uint64_t latest = std::max<uint64_t>(nextColumn, settings.history) - 1;
+    double step = static_cast<double>(settings.hop) / settings.sampleRate;
+    double right = spectrogram->columnTime(latest) + step / 2;
+    plot->xAxis->setRange(right - static_cast<double>(settings.history) * step, right);
+}
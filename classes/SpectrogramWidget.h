@@ -0,0 +1,57 @@
+// SpectrogramWidget.h - Scrolling spectrogram of a live sample stream
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include "FrameScheduler.h"
+#include "IncrementalColorMap.h"
+#include "LayerDirtyTracker.h"
+#include "StreamingSpectrogram.h"
+#include "qcustomplot_wrapper.h"
+
+// Shows the last `history` columns of a StreamingSpectrogram, time along the
+// x axis and frequency up the y axis, scrolling as columns arrive.
+//
+// The columns live in two color maps of `history` columns each, used as a
+// ring: each holds one block of consecutive columns, and when the newest
+// column leaves the newer block, the older map is moved two blocks on and
+// refilled. Nothing is reallocated, and a frame only colorizes the columns
+// that arrived since the last one.
+class SpectrogramWidget : public QWidget {
+public:
+    // Throws std::invalid_argument for an unusable config
+    explicit SpectrogramWidget(const StreamingSpectrogram::Config& config, QWidget* parent = nullptr);
+    ~SpectrogramWidget() override;
+
+    // Callable from any thread
+    void push(std::span<const double> samples);
+    // Levels outside the range get the end colors
+    void setLevelRange(double minDb, double maxDb);
+    // Empties the view and discards the samples not yet transformed
+    void clear();
+    StreamingSpectrogram::Stats stats() const;
+    FrameScheduler::Stats frameStats() const;
+
+private:
+    static constexpr uint64_t kNoBlock = UINT64_MAX;
+
+    void drainColumns();
+    // The map holding `column`, moved onto its block if need be
+    IncrementalColorMap* segmentFor(uint64_t column);
+    void showLatest();
+
+    QCustomPlot* plot;
+    QCPColorScale* colorScale;
+    std::array<IncrementalColorMap*, 2> segments{};
+    std::array<uint64_t, 2> segmentBlocks{kNoBlock, kNoBlock};
+    std::unique_ptr<LayerDirtyTracker> layers;
+    std::unique_ptr<FrameScheduler> frames;
+
+    uint64_t nextColumn = 0;  // the first column not yet drawn
+    std::atomic<bool> framePosted{false};
+
+    // Last, so its worker stops before anything it reaches is destroyed
+    std::unique_ptr<StreamingSpectrogram> spectrogram;
+};
@@ -0,0 +1,51 @@
+// SpectrogramWrapper.cpp - Qt-free wrapper implementation
+#include "SpectrogramWrapper.h"
+#include "SpectrogramWidget.h"
+
+namespace {
+
+StreamingSpectrogram::Config makeConfig(double sampleRate, size_t fftSize, size_t hop, size_t history) {
+    StreamingSpectrogram::Config config;
+    config.sampleRate = sampleRate;
+    config.fftSize = fftSize;
+    config.hop = hop;
+    config.history = history;
+    return config;
+}
+
+}
+
+SpectrogramWrapper::SpectrogramWrapper(double sampleRate, size_t fftSize, size_t hop, size_t history)
+    : impl(std::make_unique<SpectrogramWidget>(makeConfig(sampleRate, fftSize, hop, history))) {
+}
+
+SpectrogramWrapper::~SpectrogramWrapper() {
+}
+
+void SpectrogramWrapper::push(std::span<const double> samples) {
+    impl->push(samples);
+}
+
+void SpectrogramWrapper::setLevelRange(double minDb, double maxDb) {
+    impl->setLevelRange(minDb, maxDb);
+}
+
+void SpectrogramWrapper::clear() {
+    impl->clear();
+}
+
+StreamingSpectrogram::Stats SpectrogramWrapper::stats() const {
+    return impl->stats();
+}
+
+void SpectrogramWrapper::show() {
+    impl->show();
+}
+
+void SpectrogramWrapper::hide() {
+    impl->hide();
+}
+
+void* SpectrogramWrapper::getNativeHandle() const {
+    return static_cast<void*>(impl.get());
+}
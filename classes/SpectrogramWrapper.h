@@ -0,0 +1,29 @@
+// SpectrogramWrapper.h - Qt-free face of SpectrogramWidget for pybind11
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <span>
+#include "StreamingSpectrogram.h"
+
+// Forward declaration - no Qt headers in this file!
+class SpectrogramWidget;
+
+class SpectrogramWrapper {
+public:
+    SpectrogramWrapper(double sampleRate, size_t fftSize, size_t hop, size_t history);
+    ~SpectrogramWrapper();
+
+    // Safe to call from any thread
+    void push(std::span<const double> samples);
+    void setLevelRange(double minDb, double maxDb);
+    void clear();
+    StreamingSpectrogram::Stats stats() const;
+    void show();
+    void hide();
+
+    // Get native handle for integration with other Qt code
+    void* getNativeHandle() const;
+
+private:
+    std::unique_ptr<SpectrogramWidget> impl;
+};
@@ -0,0 +1,215 @@
+#include "StreamingSpectrogram.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+namespace {
+
+// The worker reports at least this often while it works through a backlog
+constexpr size_t kColumnsPerNotice = 64;
+// Power floor, so silence maps to -200 dB instead of -inf
+constexpr double kPowerFloor = 1e-20;
+
+bool isPowerOfTwo(size_t n) {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+}
+
+StreamingSpectrogram::StreamingSpectrogram(const Config& config, Callback onColumns)
+    : settings(config)
+    , onColumns(std::move(onColumns)) {
+    if (!(settings.sampleRate > 0)) throw std::invalid_argument("Sample rate must be positive");
+    if (settings.fftSize < 4 || !isPowerOfTwo(settings.fftSize)) {
+        throw std::invalid_argument("FFT size must be a power of two, at least 4");
+    }
+    if (settings.hop == 0) throw std::invalid_argument("Hop must be at least one sample");
+    if (settings.history == 0) throw std::invalid_argument("History must be at least one column");
+
+    const size_t n = settings.fftSize;
+    const size_t half = n / 2;
+    if (settings.maxBacklog == 0) {
+        settings.maxBacklog = static_cast<size_t>(settings.sampleRate / 4);
+    }
+    settings.maxBacklog = std::max(settings.maxBacklog, 4 * n);
+
+    // Periodic Hann; the gain puts a bin-centred sine at its amplitude
+    window.resize(n);
+    double sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        window[i] = 0.5 - 0.5 * std::cos(2 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(n));
+        sum += window[i];
+    }
+    levelScale = (2 / sum) * (2 / sum);
+
+    int bits = std::countr_zero(half);
+    bitReverse.resize(half);
+    for (size_t i = 0; i < half; ++i) {
+        uint32_t reversed = 0;
+        for (int b = 0; b < bits; ++b) reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+        bitReverse[i] = reversed;
+    }
+    twiddles.resize(std::max<size_t>(half / 2, 1));
+    for (size_t k = 0; k < twiddles.size(); ++k) {
+        twiddles[k] = std::polar(1.0, -2 * std::numbers::pi * static_cast<double>(k) / static_cast<double>(half));
+    }
+    unpack.resize(half + 1);
+    for (size_t k = 0; k <= half; ++k) {
+        unpack[k] = std::polar(1.0, -2 * std::numbers::pi * static_cast<double>(k) / static_cast<double>(n));
+    }
+    spectrum.resize(half);
+
+    input.resize(settings.maxBacklog);
+    columns.resize(settings.history * bins());
+    thread = std::thread([this]() { run(); });
+}
+
+StreamingSpectrogram::~StreamingSpectrogram() {
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        running = false;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void StreamingSpectrogram::push(std::span<const double> samples) {
+    if (samples.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        const size_t capacity = input.size();
+        // Of a chunk larger than the ring only the end survives
+        if (samples.size() > capacity) {
+            size_t skipped = samples.size() - capacity;
+            written += skipped;
+            samples = samples.last(capacity);
+        }
+        size_t at = static_cast<size_t>(written % capacity);
+        size_t first = std::min(samples.size(), capacity - at);
+        std::copy_n(samples.begin(), first, input.begin() + at);
+        std::copy(samples.begin() + first, samples.end(), input.begin());
+        written += samples.size();
+
+        // Drop the oldest pending samples rather than fall further behind
+        if (written > frameStart + capacity) {
+            dropped += written - capacity - frameStart;
+            frameStart = written - capacity;
+        }
+    }
+    wake.notify_one();
+}
+
+void StreamingSpectrogram::reset() {
+    std::lock_guard<std::mutex> lock(inputMutex);
+    frameStart = written;
+}
+
+uint64_t StreamingSpectrogram::readColumns(uint64_t next, const ColumnVisitor& visit) const {
+    std::lock_guard<std::mutex> lock(columnMutex);
+    const size_t count = bins();
+    uint64_t oldest = produced > settings.history ? produced - settings.history : 0;
+    for (uint64_t column = std::max(next, oldest); column < produced; ++column) {
+        size_t slot = static_cast<size_t>(column % settings.history);
+        visit(column, std::span<const float>(columns.data() + slot * count, count));
+    }
+    return std::max(next, produced);
+}
+
+double StreamingSpectrogram::columnTime(uint64_t column) const {
+    return (static_cast<double>(column) * static_cast<double>(settings.hop) +
+            static_cast<double>(settings.fftSize) / 2) / settings.sampleRate;
+}
+
+StreamingSpectrogram::Stats StreamingSpectrogram::stats() const {
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        stats.received = written;
+        stats.dropped = dropped;
+        stats.backlog = written > frameStart ? static_cast<size_t>(written - frameStart) : 0;
+    }
+    std::lock_guard<std::mutex> lock(columnMutex);
+    stats.columns = produced;
+    return stats;
+}
+
+void StreamingSpectrogram::run() {
+    const size_t n = settings.fftSize;
+    const size_t capacity = input.size();
+    std::vector<double> frame(n);
+    std::vector<float> levels(bins());
+
+    std::unique_lock<std::mutex> lock(inputMutex);
+    while (true) {
+        wake.wait(lock, [&]() { return !running || frameStart + n <= written; });
+        if (!running) return;
+
+        size_t made = 0;
+        while (running && frameStart + n <= written && made < kColumnsPerNotice) {
+            size_t at = static_cast<size_t>(frameStart % capacity);
+            size_t first = std::min(n, capacity - at);
+            std::copy_n(input.begin() + at, first, frame.begin());
+            std::copy_n(input.begin(), n - first, frame.begin() + first);
+            frameStart += settings.hop;
+
+            lock.unlock();
+            transform(frame.data(), levels.data());
+            {
+                std::lock_guard<std::mutex> columnLock(columnMutex);
+                size_t slot = static_cast<size_t>(produced % settings.history);
+                std::copy(levels.begin(), levels.end(), columns.begin() + slot * levels.size());
+                ++produced;
+            }
+            ++made;
+            lock.lock();
+        }
+        if (made > 0 && onColumns) {
+            lock.unlock();
+            onColumns();
+            lock.lock();
+        }
+    }
+}
+
+void StreamingSpectrogram::transform(const double* frame, float* levels) {
+    const size_t half = settings.fftSize / 2;
+
+    // Even samples as real parts, odd ones as imaginary, in bit-reversed order
+    for (size_t i = 0; i < half; ++i) {
+        size_t j = bitReverse[i];
+        spectrum[j] = {frame[2 * i] * window[2 * i], frame[2 * i + 1] * window[2 * i + 1]};
+    }
+
+    // Iterative radix-2; the products are spelled out because std::complex
+    // multiplication goes through a NaN-checking library call
+    for (size_t length = 2; length <= half; length <<= 1) {
+        size_t span = length / 2;
+        size_t stride = half / length;
+        for (size_t start = 0; start < half; start += length) {
+            for (size_t k = 0; k < span; ++k) {
+                std::complex<double> w = twiddles[k * stride];
+                std::complex<double> a = spectrum[start + k];
+                std::complex<double> b = spectrum[start + k + span];
+                std::complex<double> t(b.real() * w.real() - b.imag() * w.imag(),
+                                       b.real() * w.imag() + b.imag() * w.real());
+                spectrum[start + k] = a + t;
+                spectrum[start + k + span] = a - t;
+            }
+        }
+    }
+
+    // Separate the even and odd halves and combine them into bins 0..half
+    for (size_t k = 0; k <= half; ++k) {
+        std::complex<double> z = spectrum[k % half];
+        std::complex<double> mirror = std::conj(spectrum[(half - k) % half]);
+        std::complex<double> even = 0.5 * (z + mirror);
+        std::complex<double> diff = z - mirror;
+        std::complex<double> odd(0.5 * diff.imag(), -0.5 * diff.real());  // diff / 2i
+        std::complex<double> w = unpack[k];
+        double re = even.real() + odd.real() * w.real() - odd.imag() * w.imag();
+        double im = even.imag() + odd.real() * w.imag() + odd.imag() * w.real();
+        levels[k] = static_cast<float>(10 * std::log10((re * re + im * im) * levelScale + kPowerFloor));
+    }
+}
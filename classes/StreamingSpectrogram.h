@@ -0,0 +1,100 @@
+// StreamingSpectrogram.h - Overlapped, windowed FFT of a sample stream on a worker thread
+#pragma once
+#include <complex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+// Samples pushed from any thread go into a bounded ring. A worker thread cuts
+// them into Hann-windowed frames of fftSize samples, hop samples apart, and
+// turns each frame into a column of fftSize/2 + 1 levels in dB (a sine of
+// amplitude A on a bin reads 20*log10(A)). Columns go into a ring of
+// `history` slots, which the reader drains at its own pace.
+//
+// All memory is allocated up front. When the worker falls behind, the oldest
+// unprocessed samples are dropped and counted, so the newest column is never
+// more than maxBacklog samples behind the input; the dropped stretch is left
+// out rather than shown as a gap.
+class StreamingSpectrogram {
+public:
+    struct Config {
+        double sampleRate = 1e6;
+        size_t fftSize = 1024;  // power of two
+        size_t hop = 256;
+        size_t history = 1024;  // columns kept for the reader
+        size_t maxBacklog = 0;  // samples; 0 picks a quarter second, at least 4 frames
+    };
+
+    struct Stats {
+        uint64_t received = 0;  // samples
+        uint64_t dropped = 0;   // samples skipped to keep up
+        uint64_t columns = 0;   // produced so far
+        size_t backlog = 0;     // samples waiting for the worker
+    };
+
+    using Callback = std::function<void()>;
+    using ColumnVisitor = std::function<void(uint64_t column, std::span<const float> levels)>;
+
+    // Throws std::invalid_argument for an unusable config. `onColumns` runs
+    // on the worker after each batch of new columns and must not block.
+    explicit StreamingSpectrogram(const Config& config, Callback onColumns = {});
+    ~StreamingSpectrogram();
+
+    StreamingSpectrogram(const StreamingSpectrogram&) = delete;
+    StreamingSpectrogram& operator=(const StreamingSpectrogram&) = delete;
+
+    // Copies the samples; never waits for the worker
+    void push(std::span<const double> samples);
+    // Discards the samples not yet transformed
+    void reset();
+
+    // Visits the columns from `next` on, oldest first, skipping those already
+    // overwritten, and returns the `next` for the following call. The worker
+    // cannot store columns meanwhile, so keep `visit` short.
+    uint64_t readColumns(uint64_t next, const ColumnVisitor& visit) const;
+
+    const Config& config() const { return settings; }
+    size_t bins() const { return settings.fftSize / 2 + 1; }
+    double binWidth() const { return settings.sampleRate / static_cast<double>(settings.fftSize); }
+    // Seconds from the start of the stream to the centre of `column`'s frame,
+    // not counting dropped samples
+    double columnTime(uint64_t column) const;
+    Stats stats() const;
+
+private:
+    void run();
+    // Frame in, levels out; uses the worker's scratch buffers
+    void transform(const double* frame, float* levels);
+
+    Config settings;
+    Callback onColumns;
+
+    // FFT tables: the real frame is packed into fftSize/2 complex points
+    std::vector<double> window;
+    double levelScale = 1;  // squared, turns |X|^2 into amplitude^2
+    std::vector<uint32_t> bitReverse;
+    std::vector<std::complex<double>> twiddles;  // of the half-size transform
+    std::vector<std::complex<double>> unpack;    // e^{-2 pi i k / fftSize}
+    std::vector<std::complex<double>> spectrum;
+
+    // Input ring; frameStart and written count samples since the start
+    mutable std::mutex inputMutex;
+    std::condition_variable wake;
+    std::vector<double> input;
+    uint64_t written = 0;
+    uint64_t frameStart = 0;
+    uint64_t dropped = 0;
+    bool running = true;
+
+    // Column ring, `history` columns of bins() levels
+    mutable std::mutex columnMutex;
+    std::vector<float> columns;
+    uint64_t produced = 0;
+
+    std::thread thread;  // last: starts once everything above exists
+};
@@ -0,0 +1,35 @@
+#include "TraceFrameItem.h"
+
+TraceFrameItem::TraceFrameItem(QCustomPlot* plot, QCPAxis* keyAxis, QCPAxis* valueAxis, const QString& layer)
+    : QCPLayerable(plot, layer)
+    , keyAxis(keyAxis)
+    , valueAxis(valueAxis) {
+}
+
+void TraceFrameItem::setFrame(AsyncTraceRenderer::Frame frame) {
+    if (frame.id < this->frame.id) return;
+    this->frame = std::move(frame);
+}
+
+void TraceFrameItem::clear() {
+    frame.image = QImage();
+}
+
+QRect TraceFrameItem::clipRect() const {
+    return keyAxis ? keyAxis->axisRect()->rect() : QRect();
+}
+
+void TraceFrameItem::applyDefaultAntialiasingHint(QCPPainter* painter) const {
+    // Scaling a frame during a pan is a preview; keep it cheap
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+}
+
+void TraceFrameItem::draw(QCPPainter* painter) {
+    if (frame.image.isNull() || !keyAxis || !valueAxis) return;
+
+    QPointF topLeft(keyAxis->coordToPixel(frame.xRange.lower), valueAxis->coordToPixel(frame.yRange.upper));
+    QPointF bottomRight(keyAxis->coordToPixel(frame.xRange.upper), valueAxis->coordToPixel(frame.yRange.lower));
+    QRectF target(topLeft, bottomRight);
+    if (!target.isValid()) return;
+    painter->drawImage(target, frame.image);
+}
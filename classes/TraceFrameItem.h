@@ -0,0 +1,25 @@
+// TraceFrameItem.h - Shows the latest AsyncTraceRenderer frame in the plot
+#pragma once
+#include "AsyncTraceRenderer.h"
+
+// Blits a pre-rendered frame inside the axis rect. The frame is placed by
+// the ranges it was rendered for, so while a pan or zoom waits for the next
+// frame the last one moves and scales with the axes instead of freezing.
+class TraceFrameItem : public QCPLayerable {
+public:
+    TraceFrameItem(QCustomPlot* plot, QCPAxis* keyAxis, QCPAxis* valueAxis, const QString& layer);
+
+    // Ignores frames older than the one shown
+    void setFrame(AsyncTraceRenderer::Frame frame);
+    void clear();
+
+protected:
+    QRect clipRect() const override;
+    void applyDefaultAntialiasingHint(QCPPainter* painter) const override;
+    void draw(QCPPainter* painter) override;
+
+private:
+    QPointer<QCPAxis> keyAxis;
+    QPointer<QCPAxis> valueAxis;
+    AsyncTraceRenderer::Frame frame;
+};
@@ -0,0 +1,317 @@
+// fitting_bindings.cpp - Native sine fitting kernels for Python scripts (no Qt headers)
+#include "fitting_bindings.h"
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include "CppSineFitter.h"
+#include "ModelFitter.h"
+
+namespace py = pybind11;
+
+namespace {
+
+// float64 C-contiguous NumPy arrays are viewed in place; lists and other
+// dtypes are converted once on the way in
+using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+std::span<const double> view(const DoubleArray& values) {
+    if (values.ndim() != 1) {
+        throw py::value_error("expected a 1-D array");
+    }
+    return {values.data(), static_cast<size_t>(values.size())};
+}
+
+std::array<double, 4> toParams(const DoubleArray& values) {
+    if (values.size() != 4) {
+        throw py::value_error("params must have 4 elements (amplitude, frequency, phase, offset)");
+    }
+    const double* p = values.data();
+    return {p[0], p[1], p[2], p[3]};
+}
+
+// Hands the vector's buffer to NumPy without copying it
+py::array_t<double> toArray(std::vector<double>&& values) {
+    auto* owned = new std::vector<double>(std::move(values));
+    py::capsule release(owned, [](void* p) { delete static_cast<std::vector<double>*>(p); });
+    return py::array_t<double>(static_cast<py::ssize_t>(owned->size()), owned->data(), release);
+}
+
+// Same keys as the `result` dict the analysis scripts publish
+py::dict toDict(CppSineFitter::FitResult&& result) {
+    py::dict d;
+    d["fit_x"] = toArray(std::move(result.fit_x));
+    d["fit_y"] = toArray(std::move(result.fit_y));
+    d["amplitude"] = result.amplitude;
+    d["frequency"] = result.frequency;
+    d["phase"] = result.phase;
+    d["offset"] = result.offset;
+    d["r_squared"] = result.r_squared;
+    d["rmse"] = result.rmse;
+    d["aic"] = result.aic;
+    d["param_errors"] = result.param_errors;
+    d["fit_time_us"] = result.fit_time.count();
+    return d;
+}
+
+// Keeps the input arrays alive for as long as the fitter views them
+struct PySineFitter {
+    DoubleArray x;
+    DoubleArray y;
+    CppSineFitter fitter;
+
+    PySineFitter(DoubleArray x_values, DoubleArray y_values)
+        : x(std::move(x_values)), y(std::move(y_values)), fitter(view(x), view(y)) {}
+};
+
+// Calls model(x, p0, p1, ...) once for a whole batch of parameter sets: x is
+// passed as a (1, n) row and each parameter as a (count, 1) column, so
+// ordinary NumPy expressions broadcast to a (count, n) result
+ModelFitter::BatchModel batchedPythonModel(const py::function& model, const py::array& xRow, size_t k) {
+    size_t n = static_cast<size_t>(xRow.size());
+    return [model, xRow, k, n](std::span<const double> params, size_t count, std::span<double> out) {
+        py::gil_scoped_acquire gil;
+
+        py::tuple args(k + 1);
+        args[0] = xRow;
+        for (size_t j = 0; j < k; ++j) {
+            py::array_t<double> column({static_cast<py::ssize_t>(count), py::ssize_t(1)});
+            double* values = column.mutable_data();
+            for (size_t i = 0; i < count; ++i) {
+                values[i] = params[i * k + j];
+            }
+            args[j + 1] = std::move(column);
+        }
+
+        auto values = DoubleArray::ensure(model(*args));
+        if (!values) {
+            throw py::type_error("model must return an array of floats");
+        }
+        size_t size = static_cast<size_t>(values.size());
+        if (size == count * n) {
+            std::copy_n(values.data(), size, out.begin());
+        } else if (size == n) {
+            // Model ignored its parameters' batch dimension
+            for (size_t i = 0; i < count; ++i) {
+                std::copy_n(values.data(), n, out.begin() + i * n);
+            }
+        } else {
+            throw py::value_error("model returned " + std::to_string(size) + " values, expected " +
+                                  std::to_string(count) + " x " + std::to_string(n));
+        }
+    };
+}
+
+// Calls jac(x, p0, p1, ...) with the 1-D x and scalar parameters; expects (n, k)
+ModelFitter::JacobianModel pythonJacobian(const py::function& jac, const py::array& x, size_t k) {
+    size_t n = static_cast<size_t>(x.size());
+    return [jac, x, k, n](std::span<const double> params, std::span<double> out) {
+        py::gil_scoped_acquire gil;
+
+        py::tuple args(k + 1);
+        args[0] = x;
+        for (size_t j = 0; j < k; ++j) {
+            args[j + 1] = py::float_(params[j]);
+        }
+
+        auto values = DoubleArray::ensure(jac(*args));
+        if (!values) {
+            throw py::type_error("jac must return an array of floats");
+        }
+        if (static_cast<size_t>(values.size()) != n * k) {
+            throw py::value_error("jac must return an array of shape (n, " + std::to_string(k) + ")");
+        }
+        std::copy_n(values.data(), n * k, out.begin());
+    };
+}
+
+py::dict toDict(const ModelFitter::Result& result) {
+    py::dict d;
+    d["params"] = toArray(std::vector<double>(result.params));
+    d["param_errors"] = toArray(std::vector<double>(result.param_errors));
+    d["sse"] = result.sse;
+    d["r_squared"] = result.r_squared;
+    d["rmse"] = result.rmse;
+    d["evaluations"] = result.evaluations;
+    d["model_calls"] = result.model_calls;
+    d["fit_time_us"] = result.fit_time.count();
+    return d;
+}
+
+}
+
+void bindFitting(py::module_& m) {
+    m.doc() = "Native C++ fitting kernels and optimizers. Compute runs with the GIL released.";
+
+    py::class_<PySineFitter>(m, "SineFitter")
+        .def(py::init<DoubleArray, DoubleArray>(), py::arg("x"), py::arg("y"))
+        .def("__len__", [](const PySineFitter& self) { return self.fitter.size(); })
+        .def("objective", [](const PySineFitter& self, const DoubleArray& params) {
+                 auto p = toParams(params);
+                 py::gil_scoped_release release;
+                 return self.fitter.objective(p);
+             },
+             "Sum of squared residuals for one parameter set",
+             py::arg("params"))
+        .def("objective_batch", [](const PySineFitter& self, const DoubleArray& params) {
+                 if (params.ndim() != 2 || params.shape(1) != 4) {
+                     throw py::value_error("params must have shape (m, 4)");
+                 }
+                 py::array_t<double> out(params.shape(0));
+                 std::span<const double> in(params.data(), static_cast<size_t>(params.size()));
+                 std::span<double> values(out.mutable_data(), static_cast<size_t>(out.size()));
+                 {
+                     py::gil_scoped_release release;
+                     self.fitter.objectiveBatch(in, values);
+                 }
+                 return out;
+             },
+             "Objective for every row of an (m, 4) parameter array, e.g. a DE population",
+             py::arg("params"))
+        .def("residuals", [](const PySineFitter& self, const DoubleArray& params) {
+                 auto p = toParams(params);
+                 py::array_t<double> out(static_cast<py::ssize_t>(self.fitter.size()));
+                 std::span<double> values(out.mutable_data(), self.fitter.size());
+                 {
+                     py::gil_scoped_release release;
+                     self.fitter.residuals(p, values);
+                 }
+                 return out;
+             },
+             "y - model for every data point",
+             py::arg("params"))
+        .def("jacobian", [](const PySineFitter& self, const DoubleArray& params) {
+                 auto p = toParams(params);
+                 py::array_t<double> out({static_cast<py::ssize_t>(self.fitter.size()), py::ssize_t(4)});
+                 std::span<double> values(out.mutable_data(), self.fitter.size() * 4);
+                 {
+                     py::gil_scoped_release release;
+                     self.fitter.jacobian(p, values);
+                 }
+                 return out;
+             },
+             "Model derivatives as an (n, 4) array: dA, df, dphi, dc",
+             py::arg("params"))
+        .def("fit", [](PySineFitter& self, int num_fit_points) {
+                 CppSineFitter::FitResult result;
+                 {
+                     py::gil_scoped_release release;
+                     result = self.fitter.fit(num_fit_points);
+                 }
+                 return toDict(std::move(result));
+             },
+             "Differential evolution followed by Levenberg-Marquardt; returns a result dict",
+             py::arg("num_fit_points") = 300);
+
+    m.def("sine_model", [](const DoubleArray& x, const DoubleArray& params) {
+              auto p = toParams(params);
+              auto in = view(x);
+              py::array_t<double> out(static_cast<py::ssize_t>(in.size()));
+              double* values = out.mutable_data();
+              {
+                  py::gil_scoped_release release;
+                  for (size_t i = 0; i < in.size(); ++i) {
+                      values[i] = CppSineFitter::sineModel(in[i], p[0], p[1], p[2], p[3]);
+                  }
+              }
+              return out;
+          },
+          "A*sin(f*x + phi) + c evaluated over x",
+          py::arg("x"), py::arg("params"));
+
+    m.def("fit", [](DoubleArray x, DoubleArray y, int num_fit_points) {
+              PySineFitter fitter(std::move(x), std::move(y));
+              CppSineFitter::FitResult result;
+              {
+                  py::gil_scoped_release release;
+                  result = fitter.fitter.fit(num_fit_points);
+              }
+              return toDict(std::move(result));
+          },
+          "Fit one series; returns a result dict (fit_x, fit_y, amplitude, ...)",
+          py::arg("x"), py::arg("y"), py::arg("num_fit_points") = 300);
+
+    m.def("fit_batch", [](const std::vector<std::pair<DoubleArray, DoubleArray>>& traces,
+                          int num_fit_points, size_t threads) {
+              std::vector<CppSineFitter::Series> series;
+              series.reserve(traces.size());
+              for (const auto& [x, y] : traces) {
+                  series.push_back({view(x), view(y)});
+              }
+
+              std::vector<CppSineFitter::FitResult> results;
+              {
+                  py::gil_scoped_release release;
+                  results = CppSineFitter::fitBatch(series, num_fit_points, threads);
+              }
+
+              py::list out;
+              for (auto& result : results) {
+                  out.append(toDict(std::move(result)));
+              }
+              return out;
+          },
+          "Fit a list of (x, y) pairs in parallel native threads; returns a list of result dicts",
+          py::arg("traces"), py::arg("num_fit_points") = 300, py::arg("threads") = 0);
+
+    m.def("fit_model", [](const py::function& model, DoubleArray x, DoubleArray y, py::object p0,
+                          py::object jac, py::object bounds, std::string method,
+                          int max_iter, size_t pop_size, unsigned seed) {
+              auto xs = view(x);
+              auto ys = view(y);
+
+              std::vector<std::pair<double, double>> limits;
+              if (!bounds.is_none()) {
+                  limits = bounds.cast<std::vector<std::pair<double, double>>>();
+              }
+              std::vector<double> initial;
+              if (!p0.is_none()) {
+                  initial = p0.cast<std::vector<double>>();
+              }
+
+              if (method.empty()) {
+                  method = limits.empty() ? "lm" : "de+lm";
+              }
+              if (method != "lm" && method != "de" && method != "de+lm") {
+                  throw py::value_error("method must be 'lm', 'de' or 'de+lm'");
+              }
+              if (method == "lm" && initial.empty()) {
+                  throw py::value_error("method 'lm' needs p0");
+              }
+              if (method != "lm" && limits.empty()) {
+                  throw py::value_error("method '" + method + "' needs bounds");
+              }
+              size_t k = initial.empty() ? limits.size() : initial.size();
+              if (!initial.empty() && !limits.empty() && limits.size() != k) {
+                  throw py::value_error("p0 and bounds differ in length");
+              }
+
+              py::array xRow = x.attr("reshape")(1, static_cast<py::ssize_t>(xs.size()));
+              ModelFitter fitter(xs, ys, k, batchedPythonModel(model, xRow, k),
+                                 jac.is_none() ? ModelFitter::JacobianModel() : pythonJacobian(jac, x, k));
+
+              // The optimizer loop runs natively; Python is only entered per model batch
+              ModelFitter::Result result;
+              {
+                  py::gil_scoped_release release;
+                  if (method == "lm") {
+                      result = fitter.levenbergMarquardt(initial, max_iter);
+                  } else {
+                      result = fitter.differentialEvolution(limits, max_iter, pop_size, 0.8, 0.9, seed);
+                      if (method == "de+lm") {
+                          // The fitter's counters run since construction, so
+                          // evaluations and model_calls already cover both stages
+                          auto started = result.fit_time;
+                          result = fitter.levenbergMarquardt(result.params, max_iter);
+                          result.fit_time += started;
+                      }
+                  }
+              }
+              return toDict(result);
+          },
+          "Fit a user-defined model(x, *params) with native LM and/or DE.\n"
+          "The model must be vectorized: it is called once per batch with x of shape (1, n)\n"
+          "and each parameter as a (m, 1) column, and must return an (m, n) array.\n"
+          "jac(x, *params), if given, receives scalars and returns an (n, k) array.",
+          py::arg("model"), py::arg("x"), py::arg("y"), py::arg("p0") = py::none(),
+          py::arg("jac") = py::none(), py::arg("bounds") = py::none(), py::arg("method") = "",
+          py::arg("max_iter") = 200, py::arg("pop_size") = 40, py::arg("seed") = 42);
+}
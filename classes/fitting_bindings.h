@@ -0,0 +1,7 @@
+// fitting_bindings.h - Python bindings for the native sine fitting kernels
+#pragma once
+#include <pybind11/pybind11.h>
+
+// Registers the `fitting` API on `m`. Shared by the module embedded in the
+// application and the standalone extension built next to plot_module.
+void bindFitting(pybind11::module_& m);
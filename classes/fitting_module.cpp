@@ -0,0 +1,6 @@
+// fitting_module.cpp - Standalone `fitting` extension for use outside the application
+#include "fitting_bindings.h"
+
+PYBIND11_MODULE(fitting, m) {
+    bindFitting(m);
+}
@@ -1,12 +1,21 @@
 // pybind11_bindings.cpp - Clean bindings with no Qt headers
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 
-// ONLY include the wrapper header - NO Qt headers!
+// ONLY include the wrapper headers - NO Qt headers!
 #include "PlotWidgetWrapper.h"
+#include "SpectrogramWrapper.h"
 
 namespace py = pybind11;
 
+namespace {
+
+// float64 C-contiguous arrays are read in place, anything else converted once
+using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+}
+
 PYBIND11_MODULE(plot_module, m) {
     m.doc() = "QCustomPlot-based plotting widget for Python";
 
@@ -14,6 +23,9 @@ PYBIND11_MODULE(plot_module, m) {
         .def(py::init<>())
         .def("generate_sine_data", &PlotWidgetWrapper::generateSineData,
              "Generate sample sine wave data with noise")
+        .def("append_data", &PlotWidgetWrapper::appendData,
+             "Append data points after the existing ones",
+             py::arg("x"), py::arg("y"))
         .def("set_fit_data", &PlotWidgetWrapper::setFitData,
              "Set the fit curve data",
              py::arg("fit_x"), py::arg("fit_y"))
@@ -34,4 +46,41 @@ PYBIND11_MODULE(plot_module, m) {
         .def("get_native_handle", &PlotWidgetWrapper::getNativeHandle,
              "Get the native Qt widget handle (for advanced integration)",
              py::return_value_policy::reference_internal);
+
+    py::class_<SpectrogramWrapper>(m, "Spectrogram")
+        .def(py::init<double, size_t, size_t, size_t>(),
+             "Live spectrogram; fft_size must be a power of two, history is in columns",
+             py::arg("sample_rate"), py::arg("fft_size") = 1024, py::arg("hop") = 256, py::arg("history") = 1024)
+        .def("push", [](SpectrogramWrapper& self, const DoubleArray& samples) {
+                 if (samples.ndim() != 1) {
+                     throw py::value_error("expected a 1-D array");
+                 }
+                 std::span<const double> values(samples.data(), static_cast<size_t>(samples.size()));
+                 py::gil_scoped_release release;
+                 self.push(values);
+             },
+             "Queue samples for the FFT worker; drops the oldest ones if it falls behind",
+             py::arg("samples"))
+        .def("set_level_range", &SpectrogramWrapper::setLevelRange,
+             "Set the dB range the color scale spans",
+             py::arg("min_db"), py::arg("max_db"))
+        .def("clear", &SpectrogramWrapper::clear,
+             "Empty the view and discard pending samples")
+        .def("stats", [](const SpectrogramWrapper& self) {
+                 StreamingSpectrogram::Stats stats = self.stats();
+                 py::dict d;
+                 d["received"] = stats.received;
+                 d["dropped"] = stats.dropped;
+                 d["columns"] = stats.columns;
+                 d["backlog"] = stats.backlog;
+                 return d;
+             },
+             "Sample and column counters since creation")
+        .def("show", &SpectrogramWrapper::show,
+             "Show the widget")
+        .def("hide", &SpectrogramWrapper::hide,
+             "Hide the widget")
+        .def("get_native_handle", &SpectrogramWrapper::getNativeHandle,
+             "Get the native Qt widget handle (for advanced integration)",
+             py::return_value_policy::reference_internal);
 }
\ No newline at end of file
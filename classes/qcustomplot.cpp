@@ -25,6 +25,20 @@
 
 #include "qcustomplot.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
 
 /* including file 'src/vector2d.cpp'       */
 /* modified 2022-11-06T12:45:56, size 7973 */
@@ -16696,6 +16710,129 @@ void QCPColorGradient::setPeriodic(bool enabled)
   mPeriodic = enabled;
 }
 
+namespace {
+
+// Values are mapped to colors this many at a time, through stack buffers
+const int qcpColorizeBlock = 256;
+
+/*! \internal
+
+  Natural logarithm by plain arithmetic on the bits of \a x, so loops calling it vectorize where
+  a call to qLn would not. Accurate to about 1e-12 relative for positive normal numbers; the caller
+  clamps everything else into that domain.
+*/
+inline double qcpFastLn(double x)
+{
+  // x = 2^e * m with m in [sqrt(1/2), sqrt(2)), then ln(m) = 2*atanh(s) with s = (m-1)/(m+1)
+  const quint64 sqrtHalf = Q_UINT64_C(0x3fe6a09e667f3bcd);
+  quint64 bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  const quint64 shifted = bits - sqrtHalf;
+  const double exponent = double(qint32(qint64(shifted) >> 52));
+  const quint64 mantissaBits = (shifted & Q_UINT64_C(0x000fffffffffffff)) + sqrtHalf;
+  double mantissa;
+  std::memcpy(&mantissa, &mantissaBits, sizeof(mantissa));
+  const double s = (mantissa-1)/(mantissa+1);
+  const double z = s*s;
+  const double series = 1 + z*(1.0/3 + z*(1.0/5 + z*(1.0/7 + z*(1.0/9 + z*(1.0/11 + z*(1.0/13))))));
+  return exponent*0.69314718055994530942 + 2*s*series;
+}
+
+/*! \internal
+
+  Maps \a n values of \a data (addressed <tt>data[i*stride]</tt>, \a n at most qcpColorizeBlock) to
+  indices into a color buffer of \a levelCount entries, the way QCPColorGradient::color does. NaN
+  values get index -1 if \a nanIsSpecial. Each pass is a simple loop without branches, so the
+  compiler vectorizes it.
+*/
+void qcpColorIndices(const double *data, int stride, int n, const QCPRange &range, bool logarithmic, int levelCount, bool periodic, bool nanIsSpecial, qint32 *index)
+{
+  const double top = levelCount-1;
+  double position[qcpColorizeBlock];
+  if (logarithmic)
+  {
+    const double factor = top/qLn(range.upper/range.lower);
+    // Ratios that are not positive, or NaN, are clamped on their bits: negative ones to the
+    // smallest normal number and so to the bottom of the scale, NaN to infinity
+    const double smallest = std::numeric_limits<double>::min();
+    const double infinity = std::numeric_limits<double>::infinity();
+    qint64 lowestBits, highestBits;
+    std::memcpy(&lowestBits, &smallest, sizeof(lowestBits));
+    std::memcpy(&highestBits, &infinity, sizeof(highestBits));
+    for (int i=0; i<n; ++i)
+    {
+      const double ratio = data[i*stride]/range.lower;
+      qint64 bits;
+      std::memcpy(&bits, &ratio, sizeof(bits));
+      bits = std::min(std::max(bits, lowestBits), highestBits);
+      double clamped;
+      std::memcpy(&clamped, &bits, sizeof(clamped));
+      position[i] = qcpFastLn(clamped)*factor;
+    }
+  } else
+  {
+    const double factor = top/range.size();
+    for (int i=0; i<n; ++i)
+      position[i] = (data[i*stride]-range.lower)*factor;
+  }
+  
+  if (!periodic)
+  {
+    for (int i=0; i<n; ++i)
+    {
+      double p = position[i] > 0 ? position[i] : 0; // also takes NaN to 0
+      p = p < top ? p : top;
+      index[i] = qint32(p);
+    }
+  } else
+  {
+    for (int i=0; i<n; ++i)
+    {
+      double p = std::trunc(position[i]);
+      p -= std::floor(p/levelCount)*levelCount;
+      index[i] = p >= 0 && p < levelCount ? qint32(p) : 0;
+    }
+  }
+  
+  if (nanIsSpecial)
+  {
+    for (int i=0; i<n; ++i)
+      index[i] = std::isnan(data[i*stride]) ? -1 : index[i];
+  }
+}
+
+/*! \internal
+
+  Looks up the \a n colors for \a index in \a colors; entries for index -1 are left undefined.
+*/
+void qcpGatherColors(const qint32 *index, const QRgb *colors, int n, QRgb *rgb)
+{
+  for (int i=0; i<n; ++i)
+  {
+    const qint32 k = index[i];
+    rgb[i] = colors[k < 0 ? 0 : k];
+  }
+}
+
+/*! \internal
+
+  The color NaN values get with \a handling, for a color buffer \a colors of \a levelCount entries.
+*/
+QRgb qcpNanColor(QCPColorGradient::NanHandling handling, const QColor &nanColor, const QRgb *colors, int levelCount)
+{
+  switch (handling)
+  {
+    case QCPColorGradient::nhLowestColor: return colors[0];
+    case QCPColorGradient::nhHighestColor: return colors[levelCount-1];
+    case QCPColorGradient::nhTransparent: return qRgba(0, 0, 0, 0);
+    case QCPColorGradient::nhNanColor: return nanColor.rgba();
+    case QCPColorGradient::nhNone: break; // NaN is not looked for
+  }
+  return qRgba(0, 0, 0, 0);
+}
+
+} // namespace
+
 /*! \overload
   
   This method is used to quickly convert a \a data array to colors. The colors will be output in
@@ -16730,35 +16867,19 @@ void QCPColorGradient::colorize(const double *data, const QCPRange &range, QRgb
   if (mColorBufferInvalidated)
     updateColorBuffer();
   
-  const bool skipNanCheck = mNanHandling == nhNone;
-  const double posToIndexFactor = !logarithmic ? (mLevelCount-1)/range.size() : (mLevelCount-1)/qLn(range.upper/range.lower);
-  for (int i=0; i<n; ++i)
+  const bool nanIsSpecial = mNanHandling != nhNone;
+  const QRgb *colors = mColorBuffer.constData();
+  const QRgb nanRgb = qcpNanColor(mNanHandling, mNanColor, colors, mLevelCount);
+  qint32 index[qcpColorizeBlock];
+  QRgb rgb[qcpColorizeBlock];
+  for (int start=0; start<n; start+=qcpColorizeBlock)
   {
-    const double value = data[dataIndexFactor*i];
-    if (skipNanCheck || !std::isnan(value))
-    {
-      qint64 index = qint64((!logarithmic ? value-range.lower : qLn(value/range.lower)) * posToIndexFactor);
-      if (!mPeriodic)
-      {
-        index = qBound(qint64(0), index, qint64(mLevelCount-1));
-      } else
-      {
-        index %= mLevelCount;
-        if (index < 0)
-          index += mLevelCount;
-      }
-      scanLine[i] = mColorBuffer.at(index);
-    } else
-    {
-      switch(mNanHandling)
-      {
-      case nhLowestColor: scanLine[i] = mColorBuffer.first(); break;
-      case nhHighestColor: scanLine[i] = mColorBuffer.last(); break;
-      case nhTransparent: scanLine[i] = qRgba(0, 0, 0, 0); break;
-      case nhNanColor: scanLine[i] = mNanColor.rgba(); break;
-      case nhNone: break; // shouldn't happen
-      }
-    }
+    const int count = qMin(qcpColorizeBlock, n-start);
+    qcpColorIndices(data+start*dataIndexFactor, dataIndexFactor, count, range, logarithmic, mLevelCount, mPeriodic, nanIsSpecial, index);
+    qcpGatherColors(index, colors, count, rgb);
+    QRgb *pixels = scanLine+start;
+    for (int i=0; i<count; ++i)
+      pixels[i] = index[i] < 0 ? nanRgb : rgb[i];
   }
 }
 
@@ -16791,43 +16912,26 @@ void QCPColorGradient::colorize(const double *data, const unsigned char *alpha,
   if (mColorBufferInvalidated)
     updateColorBuffer();
   
-  const bool skipNanCheck = mNanHandling == nhNone;
-  const double posToIndexFactor = !logarithmic ? (mLevelCount-1)/range.size() : (mLevelCount-1)/qLn(range.upper/range.lower);
-  for (int i=0; i<n; ++i)
+  const bool nanIsSpecial = mNanHandling != nhNone;
+  const QRgb *colors = mColorBuffer.constData();
+  const QRgb nanRgb = qcpNanColor(mNanHandling, mNanColor, colors, mLevelCount);
+  qint32 index[qcpColorizeBlock];
+  QRgb rgb[qcpColorizeBlock];
+  for (int start=0; start<n; start+=qcpColorizeBlock)
   {
-    const double value = data[dataIndexFactor*i];
-    if (skipNanCheck || !std::isnan(value))
-    {
-      qint64 index = qint64((!logarithmic ? value-range.lower : qLn(value/range.lower)) * posToIndexFactor);
-      if (!mPeriodic)
-      {
-        index = qBound(qint64(0), index, qint64(mLevelCount-1));
-      } else
-      {
-        index %= mLevelCount;
-        if (index < 0)
-          index += mLevelCount;
-      }
-      if (alpha[dataIndexFactor*i] == 255)
-      {
-        scanLine[i] = mColorBuffer.at(index);
-      } else
-      {
-        const QRgb rgb = mColorBuffer.at(index);
-        const float alphaF = alpha[dataIndexFactor*i]/255.0f;
-        scanLine[i] = qRgba(int(qRed(rgb)*alphaF), int(qGreen(rgb)*alphaF), int(qBlue(rgb)*alphaF), int(qAlpha(rgb)*alphaF)); // also multiply r,g,b with alpha, to conform to Format_ARGB32_Premultiplied
-      }
-    } else
+    const int count = qMin(qcpColorizeBlock, n-start);
+    qcpColorIndices(data+start*dataIndexFactor, dataIndexFactor, count, range, logarithmic, mLevelCount, mPeriodic, nanIsSpecial, index);
+    qcpGatherColors(index, colors, count, rgb);
+    const unsigned char *alphaBlock = alpha+start*dataIndexFactor;
+    for (int i=0; i<count; ++i)
     {
-      switch(mNanHandling)
-      {
-      case nhLowestColor: scanLine[i] = mColorBuffer.first(); break;
-      case nhHighestColor: scanLine[i] = mColorBuffer.last(); break;
-      case nhTransparent: scanLine[i] = qRgba(0, 0, 0, 0); break;
-      case nhNanColor: scanLine[i] = mNanColor.rgba(); break;
-      case nhNone: break; // shouldn't happen
-      }
+      // also multiply r,g,b with alpha, to conform to Format_ARGB32_Premultiplied (an alpha of 255 leaves the color as is)
+      const float alphaF = alphaBlock[i*dataIndexFactor]/255.0f;
+      rgb[i] = qRgba(int(qRed(rgb[i])*alphaF), int(qGreen(rgb[i])*alphaF), int(qBlue(rgb[i])*alphaF), int(qAlpha(rgb[i])*alphaF));
     }
+    QRgb *pixels = scanLine+start;
+    for (int i=0; i<count; ++i)
+      pixels[i] = index[i] < 0 ? nanRgb : rgb[i];
   }
 }
 
@@ -26211,7 +26315,7 @@ void QCPColorMapData::clearAlpha()
 void QCPColorMapData::fill(double z)
 {
   const int dataCount = mValueSize*mKeySize;
-  memset(mData, z, dataCount*sizeof(*mData));
+  std::fill(mData, mData+dataCount, z);
   mDataBounds = QCPRange(z, z);
   mDataModified = true;
 }
@@ -26745,6 +26849,70 @@ QCPRange QCPColorMap::getValueRange(bool &foundRange, QCP::SignDomain inSignDoma
   return result;
 }
 
+namespace {
+
+/*! \internal
+  
+  Bands of work shared between the calling thread and Qt's global thread pool, whose threads
+  outlive the call. Every participant takes bands until none are left, so the caller never waits
+  on a pool that is busy elsewhere, and a helper that only starts after the last band was taken
+  returns without touching \a work.
+*/
+struct QCPBandJob
+{
+  std::function<void(int band)> work;
+  int bandCount = 0;
+  std::atomic<int> nextBand{0};
+  std::mutex mutex;
+  std::condition_variable finished;
+  int doneCount = 0;
+};
+
+void qcpRunBands(QCPBandJob &job)
+{
+  for (int band = job.nextBand.fetch_add(1); band < job.bandCount; band = job.nextBand.fetch_add(1))
+  {
+    job.work(band);
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if (++job.doneCount == job.bandCount)
+      job.finished.notify_all();
+  }
+}
+
+class QCPBandRunnable : public QRunnable
+{
+public:
+  explicit QCPBandRunnable(std::shared_ptr<QCPBandJob> job) : mJob(std::move(job)) {}
+  void run() override { qcpRunBands(*mJob); }
+private:
+  std::shared_ptr<QCPBandJob> mJob;
+};
+
+/*! \internal
+  
+  Calls \a work for bands 0 to \a bandCount-1 on the calling thread and the global thread pool,
+  and returns once all of them have finished.
+*/
+void qcpParallelBands(int bandCount, std::function<void(int band)> work)
+{
+  if (bandCount <= 1)
+  {
+    if (bandCount == 1)
+      work(0);
+    return;
+  }
+  auto job = std::make_shared<QCPBandJob>();
+  job->work = std::move(work);
+  job->bandCount = bandCount;
+  for (int i=1; i<bandCount; ++i)
+    QThreadPool::globalInstance()->start(new QCPBandRunnable(job));
+  qcpRunBands(*job);
+  std::unique_lock<std::mutex> lock(job->mutex);
+  job->finished.wait(lock, [&job] { return job->doneCount == job->bandCount; });
+}
+
+}
+
 /*! \internal
   
   Updates the internal map image buffer by going through the internal \ref QCPColorMapData and
@@ -26798,31 +26966,30 @@ void QCPColorMap::updateMapImage()
     
     const double *rawData = mMapData->mData;
     const unsigned char *rawAlpha = mMapData->mAlpha;
-    if (keyAxis->orientation() == Qt::Horizontal)
-    {
-      const int lineCount = valueSize;
-      const int rowCount = keySize;
-      for (int line=0; line<lineCount; ++line)
+    const bool logarithmic = mDataScaleType==QCPAxis::stLogarithmic;
+    const bool horizontal = keyAxis->orientation() == Qt::Horizontal;
+    const int lineCount = horizontal ? valueSize : keySize;
+    const int rowCount = horizontal ? keySize : valueSize;
+    const int dataIndexFactor = horizontal ? 1 : lineCount;
+    mGradient.color(mDataRange.lower, mDataRange, logarithmic); // builds the gradient's color buffer before threads share it
+    uchar *imageBits = localMapImage->bits(); // detaches once here, rather than in scanLine() on every thread
+    const int bytesPerLine = localMapImage->bytesPerLine();
+    auto colorizeLines = [&](int firstLine, int endLine)
+    {
+      for (int line=firstLine; line<endLine; ++line)
       {
-        QRgb* pixels = reinterpret_cast<QRgb*>(localMapImage->scanLine(lineCount-1-line)); // invert scanline index because QImage counts scanlines from top, but our vertical index counts from bottom (mathematical coordinate system)
+        QRgb* pixels = reinterpret_cast<QRgb*>(imageBits+(lineCount-1-line)*bytesPerLine); // invert scanline index because QImage counts scanlines from top, but our vertical index counts from bottom (mathematical coordinate system)
+        const int offset = horizontal ? line*rowCount : line;
         if (rawAlpha)
-          mGradient.colorize(rawData+line*rowCount, rawAlpha+line*rowCount, mDataRange, pixels, rowCount, 1, mDataScaleType==QCPAxis::stLogarithmic);
+          mGradient.colorize(rawData+offset, rawAlpha+offset, mDataRange, pixels, rowCount, dataIndexFactor, logarithmic);
         else
-          mGradient.colorize(rawData+line*rowCount, mDataRange, pixels, rowCount, 1, mDataScaleType==QCPAxis::stLogarithmic);
+          mGradient.colorize(rawData+offset, mDataRange, pixels, rowCount, dataIndexFactor, logarithmic);
       }
-    } else // keyAxis->orientation() == Qt::Vertical
-    {
-      const int lineCount = keySize;
-      const int rowCount = valueSize;
-      for (int line=0; line<lineCount; ++line)
-      {
-        QRgb* pixels = reinterpret_cast<QRgb*>(localMapImage->scanLine(lineCount-1-line)); // invert scanline index because QImage counts scanlines from top, but our vertical index counts from bottom (mathematical coordinate system)
-        if (rawAlpha)
-          mGradient.colorize(rawData+line, rawAlpha+line, mDataRange, pixels, rowCount, lineCount, mDataScaleType==QCPAxis::stLogarithmic);
-        else
-          mGradient.colorize(rawData+line, mDataRange, pixels, rowCount, lineCount, mDataScaleType==QCPAxis::stLogarithmic);
-      }
-    }
+    };
+    // scanlines are independent, so large maps are colorized in bands on the thread pool:
+    const int cellsPerBand = 1 << 16;
+    const int bandCount = qBound(1, int(qint64(keySize)*valueSize/cellsPerBand), qMax(1, QThread::idealThreadCount()));
+    qcpParallelBands(bandCount, [&](int band) { colorizeLines(lineCount*band/bandCount, lineCount*(band+1)/bandCount); });
     
     if (keyOversamplingFactor > 1 || valueOversamplingFactor > 1)
     {
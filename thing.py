@@ -1,6 +1,7 @@
 # Advanced sine curve fitting with simplified code and enhanced techniques
 # Available variables: x_data, y_data (numpy arrays)
-# Expected outputs: fit_x, fit_y, amplitude, frequency, phase
+# Expected outputs: result dict (fit_x, fit_y, amplitude, frequency, phase, ...)
+#                   or the same names as globals
 
 import numpy as np
 from typing import Tuple, Callable
@@ -15,6 +16,13 @@ class SineFitter:
         self.y = np.asarray(y_data, dtype=float)
         self._validate_data()
 
+        # Compiled kernels from the host application, when available
+        try:
+            import fitting
+            self._native = fitting.SineFitter(self.x, self.y)
+        except ImportError:
+            self._native = None
+
     def _validate_data(self):
         """Validate and prepare input data"""
         if len(self.x) == 0 or len(self.y) == 0:
@@ -142,6 +150,9 @@ class SineFitter:
 
     def _compute_jacobian(self, params: np.ndarray) -> np.ndarray:
         """Compute analytical Jacobian matrix"""
+        if self._native is not None:
+            return self._native.jacobian(params)
+
         amplitude, frequency, phase, offset = params
         x = self.x
 
@@ -169,7 +180,10 @@ class SineFitter:
             population[:, i] = population[:, i] * (high - low) + low
 
         # Evaluate initial population
-        fitness = np.array([self._objective(ind) for ind in population])
+        if self._native is not None:
+            fitness = self._native.objective_batch(population)
+        else:
+            fitness = np.array([self._objective(ind) for ind in population])
 
         for generation in range(max_iter):
             for i in range(pop_size):
@@ -202,6 +216,8 @@ class SineFitter:
 
     def _objective(self, params: np.ndarray) -> float:
         """Objective function for optimization"""
+        if self._native is not None:
+            return self._native.objective(params)
         try:
             predicted = self.sine_model(self.x, *params)
             return np.sum((self.y - predicted) ** 2)
@@ -308,6 +324,20 @@ try:
 
     print("\nAdvanced sine fitting completed successfully!")
 
+    # Structured result, read by the app in a single pass
+    result = {
+        "fit_x": fit_x,
+        "fit_y": fit_y,
+        "amplitude": amplitude,
+        "frequency": frequency,
+        "phase": phase,
+        "offset": metrics['final_params'][3],
+        "r_squared": metrics['r_squared'],
+        "rmse": metrics['rmse'],
+        "aic": metrics['aic'],
+        "param_errors": metrics['param_errors'],
+    }
+
 except Exception as e:
     print(f"Fitting failed: {e}")
     # Fallback